@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "memory/frame/frame.h"
+
+/**
+ * @file bench_frame.c
+ * @brief Host-side benchmark of page-colored frame allocation, on a simulated cache.
+ *
+ * The frame allocator of the kernel is linked as a host library and pointed at a malloc'ed
+ * region, whose addresses stand in for physical addresses. All frames are allocated and freed
+ * in random order first, like after a long uptime. Then a process is mapped twice: its stack
+ * pages below PROGRAM_VIRTUAL_STACK_TOP_ADDRESS and its image at PROGRAM_VIRTUAL_ADDRESS.
+ * - uncolored: frames in free list order, as a single free list hands them out.
+ * - colored: frame_alloc_colored with the color of the virtual page, as process.c does.
+ * The process then streams over its stack and image a number of times, and every access goes
+ * through a simulated physically indexed, set-associative LRU cache. The working set fits in the
+ * cache, so every miss after the first pass is a conflict miss.
+ */
+
+#define BENCH_DEFAULT_CACHE_KB 512
+#define BENCH_DEFAULT_CACHE_WAYS 8
+#define BENCH_DEFAULT_LINE_SIZE 64
+#define BENCH_DEFAULT_STACK_PAGES 4
+#define BENCH_DEFAULT_PASSES 20
+#define BENCH_DEFAULT_REGION_MB 16
+
+// Simulated physically indexed, set-associative cache with LRU replacement
+typedef struct bench_cache {
+    uint32_t num_sets;
+    uint32_t ways;
+    uint32_t line_size;
+    uintptr_t* tags;     // num_sets * ways line addresses, 0 if the way is empty
+    uint64_t* last_use;  // num_sets * ways access times of the ways
+    uint64_t time;
+    uint64_t accesses;
+    uint64_t misses;
+} bench_cache_t;
+
+// Results of streaming over a process mapped with one allocation strategy
+typedef struct bench_result {
+    uint64_t accesses;
+    uint64_t misses;
+    uint64_t compulsory_misses; // Lines touched for the first time
+    uint32_t max_pages_per_set_slice; // Most pages sharing one page color of the cache
+} bench_result_t;
+
+/**
+ * @brief Pseudo random number generator, so that runs are the same on every machine.
+ * @param state Pointer to the generator state.
+ * @return The next number.
+ */
+static uint32_t bench_random(uint32_t* state) {
+    *state = *state * 1664525U + 1013904223U;
+    return *state >> 8;
+}
+
+/**
+ * @brief Empty the cache and its counters.
+ * @param cache Pointer to the cache.
+ */
+static void bench_cache_reset(bench_cache_t* cache) {
+    memset(cache->tags, 0, (size_t)cache->num_sets * cache->ways * sizeof(uintptr_t));
+    memset(cache->last_use, 0, (size_t)cache->num_sets * cache->ways * sizeof(uint64_t));
+    cache->time = 0;
+    cache->accesses = 0;
+    cache->misses = 0;
+}
+
+/**
+ * @brief Access a physical address through the cache.
+ * @param cache Pointer to the cache.
+ * @param address The physical address.
+ */
+static void bench_cache_access(bench_cache_t* cache, uintptr_t address) {
+    uintptr_t line = address / cache->line_size + 1; // + 1 keeps 0 free for empty ways
+    uint32_t set = (uint32_t)((address / cache->line_size) % cache->num_sets);
+    uintptr_t* tags = &cache->tags[(size_t)set * cache->ways];
+    uint64_t* last_use = &cache->last_use[(size_t)set * cache->ways];
+
+    cache->time++;
+    cache->accesses++;
+    uint32_t victim = 0;
+    for (uint32_t way = 0; way < cache->ways; way++) {
+        if (tags[way] == line) {
+            last_use[way] = cache->time;
+            return;
+        }
+        if (last_use[way] < last_use[victim]) {
+            victim = way;
+        }
+    }
+
+    cache->misses++;
+    tags[victim] = line;
+    last_use[victim] = cache->time;
+}
+
+/**
+ * @brief Stream over the pages of a process, one access per cache line, and count the misses.
+ * @param cache Pointer to the cache.
+ * @param frames Frames of the pages, in virtual address order.
+ * @param num_pages Number of pages.
+ * @param passes Number of passes over all pages.
+ * @param result Pointer to store the results.
+ */
+static void bench_stream(bench_cache_t* cache, void** frames, uint32_t num_pages, uint32_t passes, bench_result_t* result) {
+    bench_cache_reset(cache);
+    for (uint32_t pass = 0; pass < passes; pass++) {
+        for (uint32_t page = 0; page < num_pages; page++) {
+            for (uint32_t offset = 0; offset < PAGE_SIZE; offset += cache->line_size) {
+                bench_cache_access(cache, (uintptr_t)frames[page] + offset);
+            }
+        }
+    }
+
+    result->accesses = cache->accesses;
+    result->misses = cache->misses;
+    result->compulsory_misses = (uint64_t)num_pages * (PAGE_SIZE / cache->line_size);
+
+    // Pages per page color of this cache, i.e. per slice of cache->num_sets
+    uint32_t cache_colors = (cache->num_sets * cache->line_size) / PAGE_SIZE;
+    uint32_t* pages_per_color = calloc(cache_colors ? cache_colors : 1, sizeof(uint32_t));
+    result->max_pages_per_set_slice = 0;
+    for (uint32_t page = 0; page < num_pages && pages_per_color; page++) {
+        uint32_t color = cache_colors ? (uint32_t)(((uintptr_t)frames[page] / PAGE_SIZE) % cache_colors) : 0;
+        if (++pages_per_color[color] > result->max_pages_per_set_slice) {
+            result->max_pages_per_set_slice = pages_per_color[color];
+        }
+    }
+    free(pages_per_color);
+}
+
+/**
+ * @brief Get the virtual address of a page of the process: the stack pages first, then the image.
+ * @param page Index of the page.
+ * @param stack_pages Number of stack pages.
+ * @return The virtual address.
+ */
+static uint32_t bench_page_address(uint32_t page, uint32_t stack_pages) {
+    if (page < stack_pages) {
+        return PROGRAM_VIRTUAL_STACK_TOP_ADDRESS - (stack_pages - page) * PAGE_SIZE;
+    }
+    return PROGRAM_VIRTUAL_ADDRESS + (page - stack_pages) * PAGE_SIZE;
+}
+
+/**
+ * @brief Print one line of results.
+ * @param name Name of the allocation strategy.
+ * @param result Pointer to the results.
+ * @param passes Number of passes.
+ */
+static void bench_print(const char* name, const bench_result_t* result, uint32_t passes) {
+    uint64_t conflict_misses = result->misses - result->compulsory_misses;
+    printf("%-10s %12llu %10llu %10llu %10.1f %13.2f %9u\n",
+           name,
+           (unsigned long long)result->accesses,
+           (unsigned long long)result->misses,
+           (unsigned long long)conflict_misses,
+           (double)conflict_misses / passes,
+           result->accesses ? 100.0 * (double)result->misses / (double)result->accesses : 0.0,
+           result->max_pages_per_set_slice);
+}
+
+/**
+ * @brief Print the command line help.
+ * @param program Name of the executable.
+ */
+static void bench_usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [-c cache KB] [-w ways] [-l line bytes] [-p image pages] [-s stack pages]\n"
+            "          [-n passes] [-r region MB] [-S seed]\n"
+            "By default the image fills the rest of the cache next to the stack.\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    uint32_t cache_kb = BENCH_DEFAULT_CACHE_KB;
+    uint32_t ways = BENCH_DEFAULT_CACHE_WAYS;
+    uint32_t line_size = BENCH_DEFAULT_LINE_SIZE;
+    uint32_t image_pages = 0;
+    uint32_t stack_pages = BENCH_DEFAULT_STACK_PAGES;
+    uint32_t passes = BENCH_DEFAULT_PASSES;
+    uint32_t region_mb = BENCH_DEFAULT_REGION_MB;
+    uint32_t seed = 1;
+
+    for (int arg = 1; arg < argc; arg++) {
+        if (arg + 1 >= argc || argv[arg][0] != '-') {
+            bench_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        uint32_t value = (uint32_t)atoi(argv[++arg]);
+        switch (argv[arg - 1][1]) {
+            case 'c': cache_kb = value; break;
+            case 'w': ways = value; break;
+            case 'l': line_size = value; break;
+            case 'p': image_pages = value; break;
+            case 's': stack_pages = value; break;
+            case 'n': passes = value; break;
+            case 'r': region_mb = value; break;
+            case 'S': seed = value; break;
+            default:
+                bench_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    uint32_t cache_size = cache_kb * 1024;
+    if (ways == 0 || line_size == 0 || passes == 0 || cache_size < ways * line_size) {
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (image_pages == 0) {
+        // The colors of the unmapped pages between the stack and the image stay unused
+        uint32_t used_pages = stack_pages + (PROGRAM_VIRTUAL_ADDRESS - PROGRAM_VIRTUAL_STACK_TOP_ADDRESS) / PAGE_SIZE;
+        image_pages = cache_size / PAGE_SIZE > used_pages ? cache_size / PAGE_SIZE - used_pages : 1;
+    }
+    uint32_t num_pages = stack_pages + image_pages;
+
+    // The region stands in for the RAM of the frame allocator
+    size_t region_size = (size_t)region_mb * 1024 * 1024;
+    void* region = aligned_alloc(PAGE_SIZE, region_size);
+    if (!region || frame_init((uintptr_t)region, (uintptr_t)region + region_size) != ENONE) {
+        fprintf(stderr, "Failed to set up a %u MB frame region\n", region_mb);
+        return EXIT_FAILURE;
+    }
+
+    bench_cache_t cache = {
+        .num_sets = cache_size / (ways * line_size),
+        .ways = ways,
+        .line_size = line_size,
+    };
+    cache.tags = malloc((size_t)cache.num_sets * ways * sizeof(uintptr_t));
+    cache.last_use = malloc((size_t)cache.num_sets * ways * sizeof(uint64_t));
+    uint32_t total_frames = (uint32_t)(region_size / PAGE_SIZE);
+    void** all_frames = malloc(total_frames * sizeof(void*));
+    void** frames = malloc(num_pages * sizeof(void*));
+    if (!cache.tags || !cache.last_use || !all_frames || !frames) {
+        return EXIT_FAILURE;
+    }
+
+    // Age the allocator: take every frame and give them back in random order
+    uint32_t taken = 0;
+    while (taken < total_frames && (all_frames[taken] = frame_alloc()) != NULL) {
+        taken++;
+    }
+    for (uint32_t i = taken; i > 1; i--) {
+        uint32_t j = bench_random(&seed) % i;
+        void* swap = all_frames[i - 1];
+        all_frames[i - 1] = all_frames[j];
+        all_frames[j] = swap;
+    }
+    for (uint32_t i = 0; i < taken; i++) {
+        frame_free(all_frames[i]);
+    }
+    if (taken < num_pages) {
+        fprintf(stderr, "The region only holds %u frames\n", taken);
+        return EXIT_FAILURE;
+    }
+
+    printf("Cache of %u KB, %u ways, %u byte lines (%u page colors), allocator with %u colors\n",
+           cache_kb, ways, line_size, cache.num_sets * line_size / PAGE_SIZE, FRAME_CACHE_COLORS);
+    printf("Process of %u stack and %u image pages, %u passes\n", stack_pages, image_pages, passes);
+    printf("%-10s %12s %10s %10s %10s %13s %9s\n",
+           "frames", "accesses", "misses", "conflicts", "conf/pass", "miss rate %", "max/color");
+
+    // Uncolored: the order of a single free list, i.e. the order the frames were freed in
+    bench_result_t result;
+    for (uint32_t page = 0; page < num_pages; page++) {
+        frames[page] = all_frames[taken - 1 - page];
+    }
+    bench_stream(&cache, frames, num_pages, passes, &result);
+    bench_print("uncolored", &result, passes);
+
+    // Colored: like process.c, the color of the virtual page
+    frame_stats_t stats_before;
+    frame_get_stats(&stats_before);
+    for (uint32_t page = 0; page < num_pages; page++) {
+        frames[page] = frame_alloc_colored(FRAME_GET_COLOR(bench_page_address(page, stack_pages)));
+    }
+    frame_stats_t stats;
+    frame_get_stats(&stats);
+    bench_stream(&cache, frames, num_pages, passes, &result);
+    bench_print("colored", &result, passes);
+    printf("Colored allocations served with another color: %u\n", stats.color_fallbacks - stats_before.color_fallbacks);
+
+    free(frames);
+    free(all_frames);
+    free(cache.last_use);
+    free(cache.tags);
+    free(region);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,695 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "memory/heap/heap.h"
+#include "memory/heap/slab.h"
+
+/**
+ * @file bench_heap.c
+ * @brief Host-side benchmark of the kernel heap, replaying alloc/free traces.
+ *
+ * The heap and slab code of the kernel is linked as a host library and pointed at a
+ * malloc'ed region. Requests are routed like kheap does: sizes of the kmalloc size classes
+ * go to slab caches, everything else to the heap itself. Every trace is replayed on a fresh
+ * heap a number of times to measure ns/op, then once more untimed to sample peak usage and
+ * fragmentation after every operation.
+ *
+ * Without trace files, the occupancy run follows: heaps of several sizes are filled to
+ * BENCH_OCCUPANCY_PERCENT with random sizes, then alloc/free pairs which keep them there are
+ * timed. The cost per pair should not grow with the heap size.
+ *
+ * Trace file format, one operation per line ('#' starts a comment):
+ *   a <id> <size>   allocate size bytes and remember the pointer as id
+ *   f <id>          free the allocation remembered as id
+ */
+
+#define BENCH_DEFAULT_HEAP_SIZE_MB 64
+#define BENCH_DEFAULT_ITERATIONS 20
+#define BENCH_SIZE_CLASS_COUNT (KERNEL_HEAP_SIZE_CLASS_MAX_SHIFT - KERNEL_HEAP_SIZE_CLASS_MIN_SHIFT + 1)
+#define BENCH_OCCUPANCY_PERCENT 90 // Share of the heap held by allocations during the occupancy run
+#define BENCH_OCCUPANCY_PAIRS 200000 // Timed alloc/free pairs per heap size
+#define BENCH_OCCUPANCY_ROUNDS 20 // The pairs are timed in rounds, the best one filters out noise
+#define BENCH_OCCUPANCY_MAX_BLOCKS 8 // Largest request of the occupancy run, in blocks
+
+// Heap sizes of the occupancy run
+static const uint32_t bench_occupancy_heap_sizes_mb[] = { 16, 64, 256 };
+#define BENCH_OCCUPANCY_HEAP_SIZE_COUNT (sizeof(bench_occupancy_heap_sizes_mb) / sizeof(bench_occupancy_heap_sizes_mb[0]))
+
+typedef enum {
+    BENCH_OP_ALLOC = 'a',
+    BENCH_OP_FREE = 'f'
+} bench_op_type_t;
+
+// One operation of a trace
+typedef struct bench_op {
+    bench_op_type_t type;
+    uint32_t id;   // Slot of the allocation in the replay
+    uint32_t size; // Requested size in bytes, allocations only
+} bench_op_t;
+
+// Sequence of operations replayed on a fresh heap
+typedef struct bench_trace {
+    char name[64];
+    bench_op_t* ops;
+    uint32_t num_ops;
+    uint32_t capacity;
+    uint32_t num_ids; // Highest id + 1
+} bench_trace_t;
+
+// Results of replaying a trace on one backend
+typedef struct bench_result {
+    double avg_ns_per_op;
+    double best_ns_per_op;
+    uint32_t peak_kb;
+    uint32_t avg_fragmentation; // Percent, averaged over the samples with free memory
+    uint32_t max_fragmentation; // Percent
+    uint32_t failed_allocations;
+} bench_result_t;
+
+// Heap under test, set up again for every replay
+typedef struct bench_heap {
+    heap_t heap;
+    heap_table_t table;
+    void* memory;
+    size_t size;
+    kmem_cache_t size_caches[BENCH_SIZE_CLASS_COUNT];
+} bench_heap_t;
+
+/**
+ * @brief Initialize the heap under test and its size class caches on the preallocated region.
+ * @param bench Pointer to the bench heap.
+ * @param backend Allocation policy of the heap.
+ * @return ENONE if successful, error code otherwise (< 0).
+ */
+static error_t bench_heap_init(bench_heap_t* bench, heap_backend_t backend) {
+    bench->table.total_blocks = bench->size >> KERNEL_HEAP_BLOCK_SIZE_SHIFT;
+    error_t err = heap_init(&bench->heap, bench->memory, (uint8_t*)bench->memory + bench->size,
+                            &bench->table, backend, KERNEL_HEAP_BLOCK_SIZE_SHIFT);
+    if (err != ENONE) {
+        return err;
+    }
+
+    for (uint32_t i = 0; i < BENCH_SIZE_CLASS_COUNT; i++) {
+        char name[KMEM_CACHE_NAME_LENGTH];
+        snprintf(name, sizeof(name), "kmalloc-%u", 1U << (KERNEL_HEAP_SIZE_CLASS_MIN_SHIFT + i));
+        err = kmem_cache_init(&bench->size_caches[i], &bench->heap, name, (size_t)1 << (KERNEL_HEAP_SIZE_CLASS_MIN_SHIFT + i), NULL);
+        if (err != ENONE) {
+            return err;
+        }
+    }
+    return ENONE;
+}
+
+/**
+ * @brief Allocate like kheap_malloc does.
+ * @param bench Pointer to the bench heap.
+ * @param size The size in bytes.
+ * @return Pointer to the allocated memory, or NULL if allocation fails.
+ */
+static void* bench_heap_malloc(bench_heap_t* bench, size_t size) {
+    if (size > 0 && size <= (1U << KERNEL_HEAP_SIZE_CLASS_MAX_SHIFT)) {
+        uint32_t shift = KERNEL_HEAP_SIZE_CLASS_MIN_SHIFT;
+        while (((size_t)1 << shift) < size) {
+            shift++;
+        }
+        return kmem_cache_alloc(&bench->size_caches[shift - KERNEL_HEAP_SIZE_CLASS_MIN_SHIFT]);
+    }
+    return heap_malloc(&bench->heap, size);
+}
+
+/**
+ * @brief Free like kheap_free does.
+ * @param bench Pointer to the bench heap.
+ * @param ptr Pointer to the memory to free.
+ */
+static void bench_heap_free(bench_heap_t* bench, void* ptr) {
+    kmem_cache_t* cache = kmem_cache_get_by_object(&bench->heap, ptr);
+    if (cache) {
+        kmem_cache_free(cache, ptr);
+    } else {
+        heap_free(&bench->heap, ptr);
+    }
+}
+
+/**
+ * @brief Append an operation to a trace.
+ * @param trace Pointer to the trace.
+ * @param type The operation type.
+ * @param id Slot of the allocation.
+ * @param size Requested size in bytes, allocations only.
+ */
+static void bench_trace_push(bench_trace_t* trace, bench_op_type_t type, uint32_t id, uint32_t size) {
+    if (trace->num_ops == trace->capacity) {
+        trace->capacity = trace->capacity ? trace->capacity * 2 : 1024;
+        trace->ops = realloc(trace->ops, trace->capacity * sizeof(bench_op_t));
+        if (!trace->ops) {
+            fprintf(stderr, "Out of memory while building trace %s\n", trace->name);
+            exit(EXIT_FAILURE);
+        }
+    }
+    trace->ops[trace->num_ops++] = (bench_op_t){ .type = type, .id = id, .size = size };
+    if (id >= trace->num_ids) {
+        trace->num_ids = id + 1;
+    }
+}
+
+/**
+ * @brief Append an allocation with a fresh id to a trace.
+ * @param trace Pointer to the trace.
+ * @param size Requested size in bytes.
+ * @return The id of the allocation.
+ */
+static uint32_t bench_trace_alloc(bench_trace_t* trace, uint32_t size) {
+    uint32_t id = trace->num_ids;
+    bench_trace_push(trace, BENCH_OP_ALLOC, id, size);
+    return id;
+}
+
+/**
+ * @brief Append a free to a trace.
+ * @param trace Pointer to the trace.
+ * @param id The id of the allocation.
+ */
+static void bench_trace_free(bench_trace_t* trace, uint32_t id) {
+    bench_trace_push(trace, BENCH_OP_FREE, id, 0);
+}
+
+/**
+ * @brief Pseudo random number generator, so that synthetic traces are the same on every machine.
+ * @param state Pointer to the generator state.
+ * @return The next number.
+ */
+static uint32_t bench_random(uint32_t* state) {
+    *state = *state * 1664525U + 1013904223U;
+    return *state >> 8;
+}
+
+#define BENCH_PROCESS_MAX_IMAGE_PAGES 16 // Largest program image of the process-load trace
+#define BENCH_PROCESS_MAX_STACK_PAGES (PROGRAM_VIRTUAL_STACK_SIZE_BYTES / KERNEL_HEAP_BLOCK_SIZE)
+#define BENCH_PROCESS_MAX_TOUCHED_STACK_PAGES 8 // Most stack pages a process of the trace touches
+
+// Allocations held by one loaded process in the process-load trace
+typedef struct bench_process {
+    uint32_t process;
+    uint32_t task;
+    uint32_t file;
+    uint32_t arena_chunks[4];
+    uint32_t num_arena_chunks;
+    uint32_t pages[BENCH_PROCESS_MAX_IMAGE_PAGES + BENCH_PROCESS_MAX_STACK_PAGES];
+    uint32_t num_pages;
+} bench_process_t;
+
+/**
+ * @brief Append the allocations of loading and running a process, following process_load and
+ *        process_handle_page_fault. The arena holds the page directory and the page tables private
+ *        to the process, and the executable stays open. Pages get a frame when first touched:
+ *        every image page, and the top stack pages the process uses.
+ * @param trace Pointer to the trace.
+ * @param process Pointer to store the ids of the allocations kept by the process.
+ * @param image_pages Size of the program image in pages, up to BENCH_PROCESS_MAX_IMAGE_PAGES.
+ * @param stack_pages Number of stack pages touched, up to BENCH_PROCESS_MAX_STACK_PAGES.
+ */
+static void bench_trace_process_load(bench_trace_t* trace, bench_process_t* process, uint32_t image_pages, uint32_t stack_pages) {
+    if (image_pages > BENCH_PROCESS_MAX_IMAGE_PAGES) {
+        image_pages = BENCH_PROCESS_MAX_IMAGE_PAGES;
+    }
+    if (stack_pages > BENCH_PROCESS_MAX_STACK_PAGES) {
+        stack_pages = BENCH_PROCESS_MAX_STACK_PAGES;
+    }
+
+    process->process = bench_trace_alloc(trace, 128);
+    process->num_arena_chunks = 0;
+    process->num_pages = 0;
+
+    // The page directory and the private tables of the stack and program regions fill one arena chunk
+    process->arena_chunks[process->num_arena_chunks++] = bench_trace_alloc(trace, PROGRAM_ARENA_CHUNK_SIZE_BYTES);
+    process->task = bench_trace_alloc(trace, 96);
+    process->file = bench_trace_alloc(trace, 32);
+
+    // The entry point and the top of the stack fault first, the rest as the program runs
+    process->pages[process->num_pages++] = bench_trace_alloc(trace, KERNEL_HEAP_BLOCK_SIZE);
+    for (uint32_t i = 0; i < stack_pages; i++) {
+        process->pages[process->num_pages++] = bench_trace_alloc(trace, KERNEL_HEAP_BLOCK_SIZE);
+    }
+    for (uint32_t i = 1; i < image_pages; i++) {
+        process->pages[process->num_pages++] = bench_trace_alloc(trace, KERNEL_HEAP_BLOCK_SIZE);
+    }
+}
+
+/**
+ * @brief Append the frees of terminating a process, following process_free.
+ * @param trace Pointer to the trace.
+ * @param process Pointer to the ids of the allocations kept by the process.
+ */
+static void bench_trace_process_free(bench_trace_t* trace, bench_process_t* process) {
+    for (uint32_t i = 0; i < process->num_pages; i++) {
+        bench_trace_free(trace, process->pages[i]);
+    }
+    bench_trace_free(trace, process->file);
+    bench_trace_free(trace, process->task);
+    for (uint32_t i = 0; i < process->num_arena_chunks; i++) {
+        bench_trace_free(trace, process->arena_chunks[i]);
+    }
+    bench_trace_free(trace, process->process);
+}
+
+/**
+ * @brief Build the process-load trace: processes of random sizes are loaded up to the
+ *        process limit, half of them are killed and replaced, then everything is torn down.
+ * @param trace Pointer to the trace to fill.
+ */
+static void bench_trace_build_process_load(bench_trace_t* trace) {
+    bench_process_t processes[PROGRAM_MAX_PROCESSES];
+    uint32_t seed = 1;
+
+    for (uint32_t round = 0; round < 8; round++) {
+        for (uint32_t i = 0; i < PROGRAM_MAX_PROCESSES; i++) {
+            if (round > 0 && (i + round) % 2 != 0) {
+                continue; // Still running from the last round
+            }
+            bench_trace_process_load(
+                trace,
+                &processes[i],
+                1 + bench_random(&seed) % BENCH_PROCESS_MAX_IMAGE_PAGES,
+                1 + bench_random(&seed) % BENCH_PROCESS_MAX_TOUCHED_STACK_PAGES
+            );
+        }
+        for (uint32_t i = 0; i < PROGRAM_MAX_PROCESSES; i++) {
+            if ((i + round + 1) % 2 == 0) {
+                bench_trace_process_free(trace, &processes[i]);
+            }
+        }
+    }
+    for (uint32_t i = 0; i < PROGRAM_MAX_PROCESSES; i++) {
+        if ((i + 8) % 2 == 0) {
+            bench_trace_process_free(trace, &processes[i]);
+        }
+    }
+}
+
+/**
+ * @brief Build the path-open trace, following fopen and fclose on FAT16:
+ *        a descriptor and a representation per open file, and every directory on the
+ *        path loaded (header and entries) and dropped again while the path is walked.
+ *        Up to 16 files are open at a time, the oldest is closed first.
+ * @param trace Pointer to the trace to fill.
+ */
+static void bench_trace_build_path_open(bench_trace_t* trace) {
+    uint32_t open_files[16][3]; // Descriptor, representation and cloned entry of each open file
+    uint32_t num_open = 0;
+    uint32_t seed = 2;
+
+    for (uint32_t i = 0; i < 4096; i++) {
+        if (num_open == 16) {
+            for (uint32_t k = 0; k < 3; k++) {
+                bench_trace_free(trace, open_files[0][2 - k]);
+            }
+            memmove(open_files[0], open_files[1], (num_open - 1) * sizeof(open_files[0]));
+            num_open--;
+        }
+
+        uint32_t descriptor = bench_trace_alloc(trace, 32);
+        uint32_t depth = bench_random(&seed) % 4;
+        for (uint32_t level = 0; level < depth; level++) {
+            uint32_t representation = bench_trace_alloc(trace, 24);
+            uint32_t directory = bench_trace_alloc(trace, 16);
+            uint32_t entries = bench_trace_alloc(trace, 32 * (2 + bench_random(&seed) % 200));
+            bench_trace_free(trace, entries);
+            bench_trace_free(trace, directory);
+            bench_trace_free(trace, representation);
+        }
+        open_files[num_open][0] = descriptor;
+        open_files[num_open][1] = bench_trace_alloc(trace, 24);
+        open_files[num_open][2] = bench_trace_alloc(trace, 32);
+        num_open++;
+    }
+    for (uint32_t i = 0; i < num_open; i++) {
+        for (uint32_t k = 0; k < 3; k++) {
+            bench_trace_free(trace, open_files[i][2 - k]);
+        }
+    }
+}
+
+/**
+ * @brief Build the mixed trace: random allocations and frees of a bounded live set,
+ *        mostly small objects with some multi-page buffers and a few large ones.
+ * @param trace Pointer to the trace to fill.
+ */
+static void bench_trace_build_mixed(bench_trace_t* trace) {
+    uint32_t live[512];
+    uint32_t num_live = 0;
+    uint32_t seed = 3;
+
+    for (uint32_t i = 0; i < 65536; i++) {
+        uint32_t r = bench_random(&seed);
+        if (num_live == 512 || (num_live > 0 && r % 2 == 0)) {
+            uint32_t index = bench_random(&seed) % num_live;
+            bench_trace_free(trace, live[index]);
+            live[index] = live[--num_live];
+            continue;
+        }
+
+        uint32_t kind = bench_random(&seed) % 100;
+        uint32_t size;
+        if (kind < 70) {
+            size = 16 + bench_random(&seed) % 2032;
+        } else if (kind < 95) {
+            size = KERNEL_HEAP_BLOCK_SIZE * (1 + bench_random(&seed) % 8);
+        } else {
+            size = 64 * 1024 + bench_random(&seed) % (448 * 1024);
+        }
+        live[num_live++] = bench_trace_alloc(trace, size);
+    }
+    while (num_live > 0) {
+        bench_trace_free(trace, live[--num_live]);
+    }
+}
+
+/**
+ * @brief Load a recorded trace from a file.
+ * @param trace Pointer to the trace to fill.
+ * @param path Path of the trace file.
+ * @return ENONE if successful, error code otherwise (< 0).
+ */
+static error_t bench_trace_load(bench_trace_t* trace, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return -EIO;
+    }
+
+    error_t err = ENONE;
+    char line[128];
+    uint32_t line_number = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        char type;
+        unsigned int id;
+        unsigned int size = 0;
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        int fields = sscanf(line, " %c %u %u", &type, &id, &size);
+        if (!((type == BENCH_OP_ALLOC && fields == 3) || (type == BENCH_OP_FREE && fields >= 2))) {
+            fprintf(stderr, "%s:%u: invalid operation\n", path, line_number);
+            err = -EINVAL;
+            break;
+        }
+        bench_trace_push(trace, (bench_op_type_t)type, id, size);
+    }
+
+    fclose(file);
+    return err;
+}
+
+/**
+ * @brief Replay a trace once on a fresh heap.
+ * @param bench Pointer to the bench heap.
+ * @param backend Allocation policy of the heap.
+ * @param trace Pointer to the trace.
+ * @param slots Pointer table indexed by allocation id, with room for every id of the trace.
+ * @param result Pointer to store the metrics, or NULL for a timed replay without sampling.
+ * @return The time spent replaying in nanoseconds.
+ */
+static uint64_t bench_replay(bench_heap_t* bench, heap_backend_t backend, bench_trace_t* trace, void** slots, bench_result_t* result) {
+    if (bench_heap_init(bench, backend) != ENONE) {
+        fprintf(stderr, "Failed to initialize the heap\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(slots, 0, trace->num_ids * sizeof(void*));
+
+    uint64_t fragmentation_sum = 0;
+    uint32_t fragmentation_samples = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (uint32_t i = 0; i < trace->num_ops; i++) {
+        bench_op_t* op = &trace->ops[i];
+        if (op->type == BENCH_OP_ALLOC) {
+            slots[op->id] = bench_heap_malloc(bench, op->size);
+        } else if (slots[op->id]) {
+            bench_heap_free(bench, slots[op->id]);
+            slots[op->id] = NULL;
+        }
+
+        if (result) {
+            heap_stats_t stats;
+            heap_get_stats(&bench->heap, &stats);
+            if (stats.free_blocks > 0) {
+                fragmentation_sum += stats.fragmentation;
+                fragmentation_samples++;
+            }
+            if (stats.fragmentation > result->max_fragmentation) {
+                result->max_fragmentation = stats.fragmentation;
+            }
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (result) {
+        result->avg_fragmentation = fragmentation_samples ? (uint32_t)(fragmentation_sum / fragmentation_samples) : 0;
+        result->peak_kb = bench->heap.stats.peak_used_blocks * (KERNEL_HEAP_BLOCK_SIZE / 1024);
+        result->failed_allocations = bench->heap.stats.failed_allocations;
+    }
+    return (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ULL + (uint64_t)(end.tv_nsec - start.tv_nsec);
+}
+
+/**
+ * @brief Measure a trace on one backend and print a line of results.
+ * @param bench Pointer to the bench heap.
+ * @param backend Allocation policy of the heap.
+ * @param trace Pointer to the trace.
+ * @param iterations Number of timed replays.
+ */
+static void bench_run(bench_heap_t* bench, heap_backend_t backend, bench_trace_t* trace, uint32_t iterations) {
+    void** slots = calloc(trace->num_ids ? trace->num_ids : 1, sizeof(void*));
+    if (!slots) {
+        fprintf(stderr, "Out of memory while replaying trace %s\n", trace->name);
+        exit(EXIT_FAILURE);
+    }
+
+    bench_result_t result = { 0 };
+    bench_replay(bench, backend, trace, slots, &result);
+
+    uint64_t total_ns = 0;
+    uint64_t best_ns = UINT64_MAX;
+    for (uint32_t i = 0; i < iterations; i++) {
+        uint64_t ns = bench_replay(bench, backend, trace, slots, NULL);
+        total_ns += ns;
+        if (ns < best_ns) {
+            best_ns = ns;
+        }
+    }
+    result.avg_ns_per_op = (double)total_ns / iterations / trace->num_ops;
+    result.best_ns_per_op = (double)best_ns / trace->num_ops;
+
+    printf("%-16s %-10s %9u %10.1f %10.1f %9u %8u%% %8u%% %7u\n",
+           trace->name, backend == HEAP_BACKEND_BUDDY ? "buddy" : "free-list", trace->num_ops,
+           result.avg_ns_per_op, result.best_ns_per_op, result.peak_kb,
+           result.avg_fragmentation, result.max_fragmentation, result.failed_allocations);
+    free(slots);
+}
+
+/**
+ * @brief Get a random request size of the occupancy run. Sizes start above the largest size class,
+ *        so every request reaches the heap backend instead of a slab cache.
+ * @param seed Pointer to the generator state.
+ * @return The size in bytes.
+ */
+static uint32_t bench_occupancy_size(uint32_t* seed) {
+    uint32_t min_size = (1U << KERNEL_HEAP_SIZE_CLASS_MAX_SHIFT) + 1;
+    return min_size + bench_random(seed) % (BENCH_OCCUPANCY_MAX_BLOCKS * KERNEL_HEAP_BLOCK_SIZE - min_size + 1);
+}
+
+/**
+ * @brief Fill a fresh heap to BENCH_OCCUPANCY_PERCENT with random sizes, time alloc/free pairs
+ *        which keep it there and print a line of results.
+ *        Each pair frees a random live allocation and allocates a new random size in its place.
+ * @param bench Pointer to the bench heap, whose region holds at least heap_size_mb.
+ * @param backend Allocation policy of the heap.
+ * @param heap_size_mb Size of the heap in MB.
+ */
+static void bench_run_occupancy(bench_heap_t* bench, heap_backend_t backend, uint32_t heap_size_mb) {
+    bench->size = (size_t)heap_size_mb * 1024 * 1024;
+    if (bench_heap_init(bench, backend) != ENONE) {
+        fprintf(stderr, "Failed to initialize the heap\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Every live allocation holds at least one block
+    uint32_t total_blocks = bench->table.total_blocks;
+    void** live = malloc(total_blocks * sizeof(void*));
+    if (!live) {
+        fprintf(stderr, "Out of memory while filling a %u MB heap\n", heap_size_mb);
+        exit(EXIT_FAILURE);
+    }
+
+    uint32_t num_live = 0;
+    uint32_t seed = 5;
+    uint32_t target_blocks = (uint32_t)((uint64_t)total_blocks * BENCH_OCCUPANCY_PERCENT / 100);
+    while (bench->heap.stats.used_blocks < target_blocks) {
+        void* ptr = bench_heap_malloc(bench, bench_occupancy_size(&seed));
+        if (!ptr) {
+            break; // Fragmented before reaching the target, measure what was reached
+        }
+        live[num_live++] = ptr;
+    }
+    uint32_t occupancy = (uint32_t)((uint64_t)bench->heap.stats.used_blocks * 100 / total_blocks);
+    uint32_t failed_allocations = bench->heap.stats.failed_allocations;
+
+    uint32_t round_pairs = BENCH_OCCUPANCY_PAIRS / BENCH_OCCUPANCY_ROUNDS;
+    uint64_t total_ns = 0;
+    uint64_t best_ns = UINT64_MAX;
+    for (uint32_t round = 0; round < BENCH_OCCUPANCY_ROUNDS; round++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        for (uint32_t i = 0; i < round_pairs && num_live > 0; i++) {
+            uint32_t index = bench_random(&seed) % num_live;
+            bench_heap_free(bench, live[index]);
+            live[index] = bench_heap_malloc(bench, bench_occupancy_size(&seed));
+            if (!live[index]) {
+                live[index] = live[--num_live];
+            }
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        uint64_t ns = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ULL + (uint64_t)(end.tv_nsec - start.tv_nsec);
+        total_ns += ns;
+        if (ns < best_ns) {
+            best_ns = ns;
+        }
+    }
+
+    heap_stats_t stats;
+    heap_get_stats(&bench->heap, &stats);
+    printf("%-8u %-10s %9u %9u%% %10.1f %12.1f %9u %7u\n",
+           heap_size_mb, backend == HEAP_BACKEND_BUDDY ? "buddy" : "free-list", num_live, occupancy,
+           (double)total_ns / (round_pairs * BENCH_OCCUPANCY_ROUNDS), (double)best_ns / round_pairs,
+           stats.free_runs, stats.failed_allocations - failed_allocations);
+    free(live);
+}
+
+/**
+ * @brief Print the command line help.
+ * @param program Name of the executable.
+ */
+static void bench_usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [-n iterations] [-m heap MB] [-b free-list|buddy|both] [trace files...]\n"
+            "Without trace files the synthetic traces process-load, path-open and mixed are replayed,\n"
+            "followed by the occupancy run on heaps of 16, 64 and 256 MB.\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+    uint32_t heap_size_mb = BENCH_DEFAULT_HEAP_SIZE_MB;
+    bool run_free_list = true;
+    bool run_buddy = true;
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (arg + 1 >= argc) {
+            bench_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        if (strcmp(argv[arg], "-n") == 0) {
+            iterations = (uint32_t)atoi(argv[++arg]);
+        } else if (strcmp(argv[arg], "-m") == 0) {
+            heap_size_mb = (uint32_t)atoi(argv[++arg]);
+        } else if (strcmp(argv[arg], "-b") == 0) {
+            const char* backend = argv[++arg];
+            run_free_list = strcmp(backend, "buddy") != 0;
+            run_buddy = strcmp(backend, "free-list") != 0;
+        } else {
+            bench_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (iterations == 0 || heap_size_mb == 0) {
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // The region is shared by the traces and the occupancy run, sized for the larger of them
+    uint32_t region_size_mb = heap_size_mb;
+    for (uint32_t i = 0; arg == argc && i < BENCH_OCCUPANCY_HEAP_SIZE_COUNT; i++) {
+        if (bench_occupancy_heap_sizes_mb[i] > region_size_mb) {
+            region_size_mb = bench_occupancy_heap_sizes_mb[i];
+        }
+    }
+    static bench_heap_t bench;
+    bench.size = (size_t)heap_size_mb * 1024 * 1024;
+    bench.memory = aligned_alloc(KERNEL_HEAP_BLOCK_SIZE, (size_t)region_size_mb * 1024 * 1024);
+    bench.table.entries = malloc(((size_t)region_size_mb * 1024 * 1024) >> KERNEL_HEAP_BLOCK_SIZE_SHIFT);
+    if (!bench.memory || !bench.table.entries) {
+        fprintf(stderr, "Failed to allocate a %u MB heap\n", region_size_mb);
+        return EXIT_FAILURE;
+    }
+    // Touch the region once, so that host page faults do not count as heap time
+    memset(bench.memory, 0, (size_t)region_size_mb * 1024 * 1024);
+
+    uint32_t num_traces = arg < argc ? (uint32_t)(argc - arg) : 3;
+    bench_trace_t* traces = calloc(num_traces, sizeof(bench_trace_t));
+    if (!traces) {
+        return EXIT_FAILURE;
+    }
+    if (arg < argc) {
+        for (uint32_t i = 0; i < num_traces; i++) {
+            const char* path = argv[arg + i];
+            const char* name = strrchr(path, '/');
+            snprintf(traces[i].name, sizeof(traces[i].name), "%s", name ? name + 1 : path);
+            if (bench_trace_load(&traces[i], path) != ENONE) {
+                fprintf(stderr, "Failed to load trace %s\n", path);
+                return EXIT_FAILURE;
+            }
+        }
+    } else {
+        snprintf(traces[0].name, sizeof(traces[0].name), "process-load");
+        bench_trace_build_process_load(&traces[0]);
+        snprintf(traces[1].name, sizeof(traces[1].name), "path-open");
+        bench_trace_build_path_open(&traces[1]);
+        snprintf(traces[2].name, sizeof(traces[2].name), "mixed");
+        bench_trace_build_mixed(&traces[2]);
+    }
+
+    printf("Heap of %u MB, %u byte blocks, %u timed replays per trace\n",
+           heap_size_mb, KERNEL_HEAP_BLOCK_SIZE, iterations);
+    printf("%-16s %-10s %9s %10s %10s %9s %9s %9s %7s\n",
+           "trace", "backend", "ops", "ns/op", "best ns/op", "peak KB", "frag avg", "frag max", "failed");
+    for (uint32_t i = 0; i < num_traces; i++) {
+        if (traces[i].num_ops == 0) {
+            continue;
+        }
+        if (run_free_list) {
+            bench_run(&bench, HEAP_BACKEND_FREE_LIST, &traces[i], iterations);
+        }
+        if (run_buddy) {
+            bench_run(&bench, HEAP_BACKEND_BUDDY, &traces[i], iterations);
+        }
+        free(traces[i].ops);
+    }
+
+    if (arg == argc) {
+        printf("\nOccupancy run: heap filled to %u%% with %u-%u byte requests, %u timed alloc/free pairs\n",
+               BENCH_OCCUPANCY_PERCENT, (1U << KERNEL_HEAP_SIZE_CLASS_MAX_SHIFT) + 1,
+               BENCH_OCCUPANCY_MAX_BLOCKS * KERNEL_HEAP_BLOCK_SIZE, BENCH_OCCUPANCY_PAIRS);
+        printf("%-8s %-10s %9s %10s %10s %12s %9s %7s\n",
+               "heap MB", "backend", "live", "occupancy", "ns/pair", "best ns/pair", "free runs", "failed");
+        for (uint32_t i = 0; i < BENCH_OCCUPANCY_HEAP_SIZE_COUNT; i++) {
+            if (run_free_list) {
+                bench_run_occupancy(&bench, HEAP_BACKEND_FREE_LIST, bench_occupancy_heap_sizes_mb[i]);
+            }
+            if (run_buddy) {
+                bench_run_occupancy(&bench, HEAP_BACKEND_BUDDY, bench_occupancy_heap_sizes_mb[i]);
+            }
+        }
+    }
+
+    free(traces);
+    free(bench.table.entries);
+    free(bench.memory);
+    return EXIT_SUCCESS;
+}
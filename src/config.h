@@ -30,6 +30,7 @@
 #define USER_DATA_SELECTOR 0x20
 /* GDT - TSS */
 #define TSS_SELECTOR 0x28
+#define KERNEL_INTERRUPT_STACK_SIZE_BYTES (16 * 1024) // Stack loaded from the TSS when entering kernel mode
 
 /* Memory */
 // Paging
@@ -37,27 +38,85 @@
 #define PAGE_TABLE_SIZE 4096
 #define PAGE_SIZE 4096
 #define PAGE_ENTRIES_PER_TABLE 1024
+// Set to 1 for PAE paging: three levels with 64-bit entries, which can address frames above 4 GB (see paging.h)
+#define PAGING_PAE_ENABLED 0
 
 // Kernel Heap
-// Allocate 100 MB for the kernel heap
-#define KERNEL_HEAP_BLOCK_SIZE PAGE_SIZE // This should match the page size
-#define KERNEL_HEAP_SIZE_BYTES (100 * 1024 * 1024)
-// NOTE: KERNEL_HEAP_MAX_BLOCKS must not exceed 0xFFFFFFFF-1 due to block index type limitation
-#define KERNEL_HEAP_MAX_BLOCKS (KERNEL_HEAP_SIZE_BYTES / KERNEL_HEAP_BLOCK_SIZE)
+// The kernel heap starts small and grows on demand up to the installed RAM
+#define KERNEL_HEAP_BLOCK_SIZE_SHIFT 12 // log2(KERNEL_HEAP_BLOCK_SIZE)
+#define KERNEL_HEAP_BLOCK_SIZE (1 << KERNEL_HEAP_BLOCK_SIZE_SHIFT) // This should match the page size
+#define KERNEL_HEAP_INITIAL_SIZE_BYTES (8 * 1024 * 1024) // 8 MB. Also the size the heap never shrinks below
+#define KERNEL_HEAP_GROW_SIZE_BYTES (4 * 1024 * 1024) // Minimum growth step when an allocation does not fit
+#define KERNEL_HEAP_SHRINK_THRESHOLD_BYTES (16 * 1024 * 1024) // Free tail above which the heap is shrunk back to one growth step
+// Headroom of the kernel heap (RAM not held by allocations) below which the cache shrinkers are called,
+// and the headroom they are asked to restore
+#define KERNEL_HEAP_LOW_WATERMARK_BYTES (1 * 1024 * 1024)
+#define KERNEL_HEAP_HIGH_WATERMARK_BYTES (4 * 1024 * 1024)
 // Note: The addresses for the kernel heap are chosen according to the memory map table
 //       collected in OSDev Wiki: https://wiki.osdev.org/Memory_Map_(x86),
 //       which can differ between systems.
 #define KERNEL_HEAP_ADDRESS 0x01000000
 #define KERNEL_HEAP_TABLE_ADDRESS 0x00007E00
+#define KERNEL_HEAP_TABLE_END_ADDRESS 0x00080000 // End of the conventional memory which is free to use
+// The block table holds one byte per block, which bounds the size the heap can grow to (~1.8 GB)
+// NOTE: KERNEL_HEAP_MAX_BLOCKS must not exceed 0xFFFFFFFF-1 due to block index type limitation
+#define KERNEL_HEAP_MAX_BLOCKS (KERNEL_HEAP_TABLE_END_ADDRESS - KERNEL_HEAP_TABLE_ADDRESS)
+#define KERNEL_HEAP_MAX_SIZE_BYTES (KERNEL_HEAP_MAX_BLOCKS * KERNEL_HEAP_BLOCK_SIZE)
+// Allocation policy of the kernel heap: HEAP_BACKEND_FREE_LIST or HEAP_BACKEND_BUDDY (see heap.h)
+#define KERNEL_HEAP_BACKEND HEAP_BACKEND_FREE_LIST
+// Requests up to 2^KERNEL_HEAP_SIZE_CLASS_MAX_SHIFT bytes are served by slab caches
+// of power-of-two sizes starting at 2^KERNEL_HEAP_SIZE_CLASS_MIN_SHIFT bytes (16 B - 2 KB)
+#define KERNEL_HEAP_SIZE_CLASS_MIN_SHIFT 4
+#define KERNEL_HEAP_SIZE_CLASS_MAX_SHIFT 11
+// Set to 1 to count kheap allocations per call site (see kheap_dump_stats)
+#define KERNEL_HEAP_PROFILING 0
+#define KERNEL_HEAP_PROFILE_MAX_CALL_SITES 64
+
+// Chunk size of the kernel scratch arena, which is reset when a system call returns
+#define KERNEL_SCRATCH_ARENA_CHUNK_SIZE_BYTES (16 * 1024)
+
+// Physical frame allocator for user pages and kernel page tables (see frame.h).
+// It gets the RAM above the kernel heap, and keeps at least the upper 1/2^FRAME_RAM_SHARE_SHIFT
+// of the RAM above KERNEL_HEAP_ADDRESS when the heap grows.
+#define FRAME_RAM_SHARE_SHIFT 1
+#define FRAME_RECLAIM_BATCH_FRAMES 32 // Frames the shrinkers are asked for when no frame is left
+// Page colors of the largest physically indexed cache: cache size / (ways * PAGE_SIZE), e.g. 1 MB 16-way
+#define FRAME_CACHE_COLORS 16
+// Free frames zeroed ahead of time while the kernel is idle, for page tables, shared memory and
+// fresh stack pages (see frame_zalloc). A multiple of FRAME_CACHE_COLORS keeps every color stocked.
+#define FRAME_ZERO_POOL_FRAMES 64
+#define FRAME_ZERO_POOL_REFILL_FRAMES 8 // Frames zeroed per idle step, bounds the time spent with interrupts off
+
+// Kernel virtual window for vmalloc. Physically scattered heap blocks are mapped here
+// to build virtually contiguous buffers. It must not overlap physical memory in use.
+#define KERNEL_VMALLOC_ADDRESS 0xD0000000
+#define KERNEL_VMALLOC_SIZE_BYTES (256 * 1024 * 1024)
+
+// Compressed in-RAM swap (zram) of cold user pages
+#define ZRAM_MAX_PAGES 16384 // Pages which can be held compressed at once (64 MB of user memory)
+#define ZRAM_MAX_COMPRESSED_SIZE_BYTES 2048 // Pages compressing worse than this stay resident. Largest kmalloc size class.
 
 // Stack for programs
+// Program pages are loaded from the executable and stack pages are allocated on first touch
 #define PROGRAM_VIRTUAL_ADDRESS 0x400000 // 4 MB. Should be aligned to page size
-#define PROGRAM_VIRTUAL_STACK_SIZE_BYTES (16 * 1024) // 16 KB. Should be multiple of page size
+#define PROGRAM_VIRTUAL_STACK_SIZE_BYTES (1024 * 1024) // 1 MB. Limit the stack grows down to. Should be multiple of page size
 #define PROGRAM_VIRTUAL_STACK_TOP_ADDRESS 0x3FF000 // Just below 4 MB. Should be aligned to page size
 #define PROGRAM_VIRTUAL_STACK_BOTTOM_ADDRESS (PROGRAM_VIRTUAL_STACK_TOP_ADDRESS - PROGRAM_VIRTUAL_STACK_SIZE_BYTES)
-#define PROGRAM_MAX_ALLOCATIONS 1024 // Maximum number of memory allocations per program which can be tracked
+// Window of the address space which processes map their own pages into. Kernel pages
+// outside of it are the same in every address space and mapped global.
+#define PROGRAM_VIRTUAL_SPACE_START_ADDRESS 0x200000 // 2 MB, above the kernel image and boot stack
+#define PROGRAM_VIRTUAL_SPACE_END_ADDRESS 0x1000000 // 16 MB, start of the kernel heap
+#define PROGRAM_VIRTUAL_SHM_START_ADDRESS 0xC00000 // 12 MB. Shared memory is attached from here to the end of the window, the image must end below
+#define PROGRAM_ARENA_CHUNK_SIZE_BYTES (16 * 1024) // Chunk size of the per-process arena holding the page directory and private page tables
 #define PROGRAM_MAX_PROCESSES 12 // Maximum number of processes in the system
 
+// Copy-on-write sharing of user frames
+#define COW_FRAME_HASH_BUCKETS 1024 // Buckets of the share counts of frames mapped more than once
+
+// Shared memory regions between processes
+#define SHM_MAX_REGIONS 16 // Regions which can exist at once in the system
+#define SHM_MAX_ATTACHMENTS 8 // Regions a process can have attached at once
+
 /* Disk */
 #define DISK_SECTOR_SIZE 512
 #define DISK_MAX_DISKS 1
@@ -14,6 +14,8 @@
  *        streaming provides a more flexible and efficient way to handle data transfers.
  */
 
+static kmem_cache_t* disk_streamer_cache = NULL; // Object cache for disk_streamer_t, created on first use
+
  /**
   * @brief Create a disk streamer for the specified disk UID.
   * @param disk_uid The unique identifier of the disk.
@@ -25,7 +27,14 @@ disk_streamer_t* disk_streamer_create(uint8_t disk_uid) {
         return NULL; // Disk not found
     }
 
-    disk_streamer_t* streamer = (disk_streamer_t*)kheap_zmalloc(sizeof(disk_streamer_t));
+    if (!disk_streamer_cache) {
+        disk_streamer_cache = kmem_cache_create("disk_streamer", sizeof(disk_streamer_t), NULL);
+        if (!disk_streamer_cache) {
+            return NULL; // Memory allocation failed
+        }
+    }
+
+    disk_streamer_t* streamer = (disk_streamer_t*)kmem_cache_alloc(disk_streamer_cache);
     if (!streamer) {
         return NULL; // Memory allocation failed
     }
@@ -112,5 +121,5 @@ void disk_streamer_destroy(disk_streamer_t* streamer) {
         return;
     }
 
-    kheap_free(streamer);
+    kmem_cache_free(disk_streamer_cache, streamer);
 }
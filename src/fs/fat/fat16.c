@@ -3,6 +3,7 @@
 #include "utils/string.h"
 #include "disk/disk.h"
 #include "memory/heap/kheap.h"
+#include "memory/vmalloc/vmalloc.h"
 #include "memory/memory.h"
 
 /* Function prototypes */
@@ -22,6 +23,7 @@ static file_system_t fat16_fs = {
     .stat = fat16_stat,
     .close = fat16_close
 };
+static kmem_cache_t* fat16_entry_cache = NULL; // Object cache for the cloned directory entries of open files
 
 /**
  * @brief Count the number of in-use entries in a FAT16 directory.
@@ -75,13 +77,14 @@ int fat16_get_root_directory(disk_t* disk, fat_fs_private_data_t* fs_data) {
     uint32_t root_dir_size_bytes = primary_header->root_entry_count * sizeof(fat_directory_entry_t);
     uint32_t root_dir_size_sectors = (root_dir_size_bytes + disk->sector_size - 1) / disk->sector_size;
 
-    // Allocate memory for root directory entries
-    fat_directory_entry_t* entries = (fat_directory_entry_t*)kheap_zmalloc(root_dir_size_bytes);
-    if (!entries) {
+    // The root directory lives as long as the mount, so keep its entries movable
+    heap_handle_t* entries_handle = kheap_malloc_movable(root_dir_size_bytes);
+    if (!entries_handle) {
         res = -ENOMEM; // Memory allocation error
         goto exit;
     }
     // Read root directory entries from disk
+    fat_directory_entry_t* entries = (fat_directory_entry_t*)kheap_pin(entries_handle);
     disk_streamer_t* dir_streamer = fs_data->directory_streamer;
     if (disk_streamer_seek(dir_streamer, root_dir_position_sectors * disk->sector_size) < 0) {
         res = -EIO; // I/O error
@@ -99,16 +102,20 @@ int fat16_get_root_directory(disk_t* disk, fat_fs_private_data_t* fs_data) {
         goto exit;
     }
 
-    fs_data->root_directory.entries = entries;
+    fs_data->root_directory.entries = NULL;
+    fs_data->root_directory.entries_handle = entries_handle;
     fs_data->root_directory.in_use_entry_count = (uint32_t)in_use_count;
     fs_data->root_directory.start_pos = root_dir_position_sectors;
     fs_data->root_directory.end_pos = root_dir_position_sectors + root_dir_size_sectors -1;
 
 exit:
+    if (entries_handle) {
+        kheap_unpin(entries_handle);
+    }
     if (res < 0) {
         // Cleanup on failure
-        if (entries) {
-            kheap_free(entries);
+        if (entries_handle) {
+            kheap_free_movable(entries_handle);
         }
     }
 
@@ -321,7 +328,7 @@ fat_directory_t* fat16_load_directory(disk_t* disk, fat_directory_entry_t* entry
 
     // Allocate memory for directory entries
     uint32_t entries_size = total_entries * sizeof(fat_directory_entry_t);
-    directory->entries = (fat_directory_entry_t*)kheap_zmalloc(entries_size);
+    directory->entries = (fat_directory_entry_t*)kvzmalloc(entries_size);
     if (!directory->entries) {
         goto failed; // Memory allocation error
     }
@@ -338,7 +345,7 @@ fat_directory_t* fat16_load_directory(disk_t* disk, fat_directory_entry_t* entry
 failed:
     if (directory) {
         if (directory->entries) {
-            kheap_free(directory->entries);
+            kvfree(directory->entries);
         }
         kheap_free(directory);
     }
@@ -346,7 +353,7 @@ failed:
 }
 
 fat_directory_entry_t* fat16_clone_directory_entry(fat_directory_entry_t* entry) {
-    fat_directory_entry_t* cloned_entry = (fat_directory_entry_t*)kheap_zmalloc(sizeof(fat_directory_entry_t));
+    fat_directory_entry_t* cloned_entry = (fat_directory_entry_t*)kmem_cache_alloc(fat16_entry_cache);
     if (!cloned_entry) {
         return NULL; // Memory allocation error
     }
@@ -398,11 +405,11 @@ void fat16_free_file_directory_representation(fat_file_directory_representation_
         if (representation->type == FAT_DIRECTORY_ENTRY_TYPE_DIRECTORY && representation->directory) {
             // Free directory entries
             if (representation->directory->entries) {
-                kheap_free(representation->directory->entries);
+                kvfree(representation->directory->entries);
             }
             kheap_free(representation->directory);
         } else if (representation->sfn_entry) {
-            kheap_free(representation->sfn_entry);
+            kmem_cache_free(fat16_entry_cache, representation->sfn_entry);
         }
         kheap_free(representation);
     }
@@ -416,6 +423,10 @@ void fat16_free_file_directory_representation(fat_file_directory_representation_
  */
 fat_file_directory_representation_t* fat16_search_file(disk_t* disk, fat_directory_t* directory, const char* name) {
     fat_file_directory_representation_t* result = NULL;
+    // Keep movable entries in place while the loop allocates the representation
+    if (directory->entries_handle) {
+        directory->entries = (fat_directory_entry_t*)kheap_pin(directory->entries_handle);
+    }
     for (uint32_t i = 0; i < directory->in_use_entry_count; i++) {
         fat_directory_entry_t* entry = &directory->entries[i];
         // Get the full file name with extension. Get 1 on success, 0 if not a file.
@@ -428,6 +439,10 @@ fat_file_directory_representation_t* fat16_search_file(disk_t* disk, fat_directo
             result = fat16_create_file_directory_representation(disk, entry);
         }
     }
+    if (directory->entries_handle) {
+        kheap_unpin(directory->entries_handle);
+        directory->entries = NULL;
+    }
     return result; // File not found
 }
 
@@ -668,5 +683,12 @@ int fat16_close(file_descriptor_t* fd) {
  * @return Pointer to the initialized FAT16 file system structure.
  */
 file_system_t* fat16_init() {
+    // Every open file holds a clone of its directory entry
+    if (!fat16_entry_cache) {
+        fat16_entry_cache = kmem_cache_create("fat_directory_entry", sizeof(fat_directory_entry_t), NULL);
+        if (!fat16_entry_cache) {
+            return NULL;
+        }
+    }
     return &fat16_fs;
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 #include "disk/streamer.h"
+#include "memory/heap/heap.h"
 
 typedef enum {
     FAT_DIRECTORY_ENTRY_TYPE_DIRECTORY = 0,
@@ -116,7 +117,8 @@ typedef struct fat_header {
 } fat_header_t;
 
 typedef struct fat_directory {
-    fat_directory_entry_t* entries; // Pointer to an array of directory entries
+    fat_directory_entry_t* entries; // Pointer to an array of directory entries, NULL while a movable array is unpinned
+    heap_handle_t* entries_handle;  // Movable array of directory entries of a long-lived directory, or NULL
     uint32_t in_use_entry_count;    // Number of in-use entries in the directory
     uint32_t start_pos;             // Starting position (sector) of the directory
     uint32_t end_pos;               // Ending position (sector) of the directory
@@ -3,6 +3,7 @@
 #include "pparser.h"
 #include "utils/string.h"
 #include "memory/heap/kheap.h"
+#include "memory/memory.h"
 
 /**
  * @file file.c
@@ -17,6 +18,16 @@
 
 static file_system_t* file_systems[FS_MAX_FILE_SYSTEMS];
 static file_descriptor_t* file_descriptors[FS_MAX_FILE_DESCRIPTORS]; // 1-based indexing
+static kmem_cache_t* file_descriptor_cache = NULL; // Object cache for file_descriptor_t
+
+/**
+ * @brief Constructor of the file descriptor cache, hands out zeroed descriptors.
+ * @param object Pointer to the file descriptor.
+ */
+static void file_descriptor_ctor(void* object) {
+    memset(object, 0, sizeof(file_descriptor_t));
+}
+
 /**
  * @brief Find a free slot in the file system table.
  * @return Pointer to the free slot, or NULL if none available.
@@ -82,7 +93,7 @@ int file_new_descriptor(file_descriptor_t** out_fd) {
     for (int i = 0; i < FS_MAX_FILE_DESCRIPTORS; i++) {
         if (file_descriptors[i] == NULL) {
             // Allocate and initialize a new file descriptor
-            file_descriptor_t* fd = kheap_zmalloc(sizeof(file_descriptor_t));
+            file_descriptor_t* fd = kmem_cache_alloc(file_descriptor_cache);
             if (!fd) {
                 return -ENOMEM; // Memory allocation error
             }
@@ -103,7 +114,7 @@ void file_free_descriptor(file_descriptor_t* fd) {
     if (fd && fd->id > 0 && fd->id <= FS_MAX_FILE_DESCRIPTORS) {
         uint32_t index = fd->id - 1;
         // Free the file descriptor structure
-        kheap_free(fd);
+        kmem_cache_free(file_descriptor_cache, fd);
         file_descriptors[index] = NULL; // Mark slot as free
     }
 }
@@ -136,6 +147,12 @@ error_t file_init() {
         file_descriptors[i] = NULL;
     }
 
+    // Create the object cache for file descriptors
+    file_descriptor_cache = kmem_cache_create("file_descriptor", sizeof(file_descriptor_t), file_descriptor_ctor);
+    if (!file_descriptor_cache) {
+        return -ENOMEM;
+    }
+
     // Load file systems
     if (file_load_file_systems() != ENONE) {
         return -EIO;
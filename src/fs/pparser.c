@@ -1,5 +1,5 @@
 #include "pparser.h"
-#include "memory/heap/kheap.h"
+#include "memory/arena/arena.h"
 #include "memory/memory.h"
 #include "utils/string.h"
 #include <stddef.h>
@@ -8,6 +8,8 @@
 /**
  * @file pparser.c
  * @brief Path parser implementation.
+ *        A parsed path lives in the kernel scratch arena. It is short-lived and
+ *        always freed in reverse order of parsing, so path_free is a single release.
  */
 
  /**
@@ -45,17 +47,19 @@ uint8_t path_get_drive_no(const char** path) {
 
 /**
  * @brief Create a new path_root_t structure with the specified drive number.
- *        Note: The created structure should be freed by the caller using kheap_free.
+ *        The structure is allocated from the scratch arena and released with path_free.
  * @param drive_no The drive number to set in the path root.
  * @return Pointer to the newly created path_root_t structure, or NULL on failure.
  */
 path_root_t* path_create_root(uint8_t drive_no) {
-    path_root_t* root = (path_root_t*)kheap_zmalloc(sizeof(path_root_t));
+    arena_mark_t mark = arena_get_mark(arena_scratch());
+    path_root_t* root = (path_root_t*)arena_zalloc(arena_scratch(), sizeof(path_root_t));
     if (!root) {
         return NULL; // Memory allocation failed
     }
     root->drive_no = drive_no;
     root->first = NULL;
+    root->mark = mark;
     return root;
 }
 
@@ -112,16 +116,15 @@ path_part_t* path_parse_path_parts(const char** path) {
         part_buffer[part_length] = '\0';
 
         // create a new path_part_t
-        path_part_t* new_part = (path_part_t*)kheap_zmalloc(sizeof(path_part_t));
+        path_part_t* new_part = (path_part_t*)arena_zalloc(arena_scratch(), sizeof(path_part_t));
         if (!new_part) {
-            // memory allocation failed
-            goto cleanup;
+            // memory allocation failed, the parts so far are released together with the root
+            return NULL;
         }
 
-        new_part->name = (const char*)kheap_zmalloc(part_length + 1);
+        new_part->name = (const char*)arena_alloc(arena_scratch(), part_length + 1);
         if (!new_part->name) {
-            kheap_free(new_part);
-            goto cleanup;
+            return NULL;
         }
         strcpy((char*)new_part->name, part_buffer);
         new_part->next = NULL;
@@ -137,16 +140,6 @@ path_part_t* path_parse_path_parts(const char** path) {
     }
 
     return head;
-
-cleanup:
-    // free allocated parts in case of error
-    path_part_t* current = head;
-    while (current) {
-        path_part_t* next = current->next;
-        kheap_free(current);
-        current = next;
-    }
-    return NULL;
 }
 
 path_root_t* path_parse(const char* path) {
@@ -166,7 +159,7 @@ path_root_t* path_parse(const char* path) {
 
     root->first = path_parse_path_parts(&path);
     if (!root->first) {
-        kheap_free(root);
+        path_free(root);
         return NULL;
     }
 
@@ -175,14 +168,10 @@ path_root_t* path_parse(const char* path) {
 
 /**
  * @brief Free the memory allocated for a parsed path.
+ *        Everything allocated from the scratch arena after the path is released as well,
+ *        so parsed paths must be freed in reverse order of parsing.
  * @param parsed_path Pointer to the parsed path structure to free.
  */
 void path_free(path_root_t* parsed_path) {
-    path_part_t* current = parsed_path->first;
-    while (current) {
-        path_part_t* next = current->next;
-        kheap_free(current);
-        current = next;
-    }
-    kheap_free(parsed_path);
+    arena_release(arena_scratch(), parsed_path->mark);
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include "config.h"
 #include "status.h"
+#include "memory/arena/arena.h"
 
 /* Type Definitions */
 typedef struct path_part {
@@ -14,6 +15,7 @@ typedef struct path_part {
 typedef struct {
     uint8_t drive_no; // Drive number (e.g., 0 for A:, 1 for B:, etc.)
     path_part_t* first; // Pointer to the first directory/file part
+    arena_mark_t mark; // Scratch arena position before the path was parsed
 } path_root_t;
 
 /* Exported Functions */
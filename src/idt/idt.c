@@ -5,7 +5,12 @@
 #include "io/io.h"
 #include "kernel.h"
 #include "task/task.h"
+#include "task/process.h"
 #include "status.h"
+#include "memory/paging/paging.h"
+#include "memory/zram/zram.h"
+#include "memory/cow/cow.h"
+#include "memory/uaccess/uaccess.h"
 
 // Define gate type for 32-bit interrupt gate with Ring 3 privilege and present bit set
 #define GATE_TYPE_INT_32 (IDT_GATE_TYPE_INT_GATE_32 | IDT_DPL_RING3 | IDT_PRESENT)
@@ -18,6 +23,7 @@ static idt_interrupt_handler_t idt_general_interrupt_handlers[TOTAL_INTERRUPTS];
 extern void idt_load(uint32_t idt_ptr_address);
 extern void idt_interrupt_stub();
 extern void idt_isr80h_handler_asm(); // System call interrupt handler written in assembly
+extern void idt_page_fault_handler_asm(); // Page fault handler written in assembly, passes CR2 and the error code
 extern void* idt_general_interrupt_handler_table[TOTAL_INTERRUPTS]; // Table of general interrupt handlers implemented in assembly
 
 void idt_div_by_zero_handler() {
@@ -27,7 +33,39 @@ void idt_div_by_zero_handler() {
     while (1);
 }
 
-void idt_page_fault_handler(idt_interrupt_stack_frame_t* frame, uint32_t faulting_address) {
+/**
+ * @brief The page fault handler in C.
+ *        Faults on pages compressed out by zram are resolved in the address space
+ *        which was active, program and stack pages of the current process are mapped
+ *        on first touch, writes to copy-on-write pages get a private copy, and the faulting
+ *        instruction is retried. Kernel accesses to user memory which cannot be resolved
+ *        continue at their uaccess fixup. Anything else is fatal.
+ * @param faulting_address The address which caused the fault (CR2).
+ * @param error_code The error code pushed by the CPU.
+ * @param frame Pointer to the interrupt stack frame.
+ */
+void idt_page_fault_handler_c(uint32_t faulting_address, uint32_t error_code, idt_interrupt_stack_frame_t* frame) {
+    if ((error_code & IDT_PAGE_FAULT_PRESENT) && (error_code & IDT_PAGE_FAULT_WRITE)) {
+        if (cow_handle_write_fault(paging_get_current_4gb_chunk(), faulting_address) == ENONE) {
+            return;
+        }
+    } else if (!(error_code & IDT_PAGE_FAULT_PRESENT)) {
+        uint32_t page_address = faulting_address & ~(uint32_t)(PAGE_SIZE - 1);
+        if (zram_swap_in(paging_get_current_4gb_chunk(), page_address) == ENONE) {
+            return;
+        }
+        task_t* task = task_get_current();
+        if (task && task->paging_chunk == paging_get_current_4gb_chunk() &&
+            process_handle_page_fault(task->process, faulting_address) == ENONE) {
+            return;
+        }
+    }
+
+    if (!(error_code & IDT_PAGE_FAULT_USER) && uaccess_fixup_page_fault(frame)) {
+        return;
+    }
+
+    printf("Page fault at %x, error code %x, eip %x\n", faulting_address, error_code, frame->eip);
     panic("Page Fault Exception!");
 }
 
@@ -85,7 +123,7 @@ void idt_init() {
     idt_set_gate(0, (uint32_t)idt_div_by_zero_handler, KERNEL_CODE_SELECTOR, GATE_TYPE_INT_32);
 
     // Page Fault Exception (ISR 14)
-    idt_set_gate(14, (uint32_t)idt_page_fault_handler, KERNEL_CODE_SELECTOR, GATE_TYPE_INT_32);
+    idt_set_gate(14, (uint32_t)idt_page_fault_handler_asm, KERNEL_CODE_SELECTOR, GATE_TYPE_INT_32);
 
     // Control Protection Fault Exception (ISR 21)
     idt_set_gate(21, (uint32_t)idt_control_protection_fault_handler, KERNEL_CODE_SELECTOR, GATE_TYPE_INT_32);
@@ -108,7 +146,7 @@ int idt_register_interrupt_handler(uint16_t interrupt_number, idt_interrupt_hand
 void idt_general_interrupt_handler_c(uint16_t interrupt_number, idt_interrupt_stack_frame_t* frame) {
     // printf("General Interrupt Received! Interrupt Number: %d\n", interrupt_number);
 
-    // Switch to kernel paging
+    // Enter the kernel landscape, the task's page directory stays loaded
     kernel_page();
     // If there is a registered handler, call it
     if (idt_general_interrupt_handlers[interrupt_number]) {
@@ -117,7 +155,7 @@ void idt_general_interrupt_handler_c(uint16_t interrupt_number, idt_interrupt_st
         // Call the registered handler
         idt_general_interrupt_handlers[interrupt_number](frame);
     }
-    // Return to user paging after interrupt handling
+    // Return to user mode segments, CR3 is only reloaded if the current task changed
     task_page_current();
     
     // Send End of Interrupt (EOI) signal to PICs
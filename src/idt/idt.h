@@ -15,6 +15,11 @@
 
 #define IDT_PRESENT                 0x80  // 1 << 7
 
+// Page fault error code bits
+#define IDT_PAGE_FAULT_PRESENT      0x1   // The page was present (protection violation)
+#define IDT_PAGE_FAULT_WRITE        0x2   // The access was a write
+#define IDT_PAGE_FAULT_USER         0x4   // The access came from user mode
+
 // Types and function prototypes for Interrupt Descriptor Table (IDT) management
 /**
  * @brief Structure representing an entry in the Interrupt Descriptor Table (IDT).
@@ -70,5 +75,6 @@ extern void idt_disable_interrupts();
 void idt_init();
 int idt_register_interrupt_handler(uint16_t interrupt_number, idt_interrupt_handler_t handler);
 void idt_general_interrupt_handler_c(uint16_t interrupt_number, idt_interrupt_stack_frame_t* frame);
+void idt_page_fault_handler_c(uint32_t faulting_address, uint32_t error_code, idt_interrupt_stack_frame_t* frame);
 
 #endif // __IDT_H__
@@ -1,8 +1,10 @@
 #include "io.h"
 #include "task/task.h"
+#include "memory/uaccess/uaccess.h"
 #include "utils/stdio.h"
 #include "status.h"
 #include "keyboard/keyboard.h"
+#include "kernel.h"
 
 #define MAX_PRINT_LENGTH 1024
 
@@ -26,17 +28,18 @@ void* io_isr80h_command_print(idt_interrupt_stack_frame_t* frame) {
         goto exit;
     }
     // Get the pointer to the string from the stack
-    const char* str_ptr = (const char*)task_get_stack_item(current_task, 0);
-    if (!str_ptr) {
-        res = -EFAULT; // Failed to get string pointer
-        goto exit;
+    uint32_t str_ptr = 0;
+    res = task_get_stack_item(current_task, 0, &str_ptr);
+    if (res != ENONE) {
+        goto exit; // Failed to get string pointer
     }
     // Copy the string from the task's memory space to a kernel buffer
     char buffer[MAX_PRINT_LENGTH];
-    res = task_copy_string_from_task(current_task, str_ptr, buffer, MAX_PRINT_LENGTH);
-    if (res != ENONE) {
+    res = strncpy_from_user(buffer, (const char*)str_ptr, MAX_PRINT_LENGTH);
+    if (res < 0) {
         goto exit; // Propagate error
     }
+    res = ENONE;
     // Print the string to the console
     printf("%s", buffer);
 
@@ -54,6 +57,10 @@ void* io_isr80h_command_get_keyboard_char(idt_interrupt_stack_frame_t* frame) {
     // We are in kernel mode here
     //////////////////////////////////////
     char c = keyboard_pop();
+    if (c == '\0') {
+        // The task is polling for input, so the system is idle
+        kernel_idle();
+    }
     return (void*)(intptr_t)c;
 }
 
@@ -71,8 +78,12 @@ void* io_isr80h_command_put_char(idt_interrupt_stack_frame_t* frame) {
     if (!current_task) {
         return ERROR_VOID(-EFAULT); // No current task
     }
-    char c = (char)(intptr_t)task_get_stack_item(current_task, 0);
+    uint32_t c = 0;
+    int res = task_get_stack_item(current_task, 0, &c);
+    if (res != ENONE) {
+        return ERROR_VOID(res);
+    }
     // Output the character to the terminal
-    printf("%c", c);
+    printf("%c", (char)c);
     return ERROR_VOID(ENONE);
 }
\ No newline at end of file
@@ -2,9 +2,12 @@
 #include "misc.h"
 #include "status.h"
 #include "io.h"
+#include "process.h"
+#include "shm.h"
 #include "config.h"
 #include "kernel.h"
 #include "task/task.h"
+#include "memory/arena/arena.h"
 #include <stddef.h>
 
 static isr80h_command_handler_t isr80h_command_handlers[ISR80H_MAX_COMMANDS];
@@ -19,6 +22,10 @@ int isr80h_register_commands() {
     res += isr80h_register_handler(ISR80H_CMD_PRINT, io_isr80h_command_print);
     res += isr80h_register_handler(ISR80H_CMD_GET_KEYBOARD_CHAR, io_isr80h_command_get_keyboard_char);
     res += isr80h_register_handler(ISR80H_CMD_PUT_CHAR, io_isr80h_command_put_char);
+    res += isr80h_register_handler(ISR80H_CMD_FORK, process_isr80h_command_fork);
+    res += isr80h_register_handler(ISR80H_CMD_SHM_CREATE, shm_isr80h_command_create);
+    res += isr80h_register_handler(ISR80H_CMD_SHM_ATTACH, shm_isr80h_command_attach);
+    res += isr80h_register_handler(ISR80H_CMD_SHM_DETACH, shm_isr80h_command_detach);
 
     return res;
 }
@@ -48,7 +55,7 @@ void* isr80h_handler_c(int syscall_number, idt_interrupt_stack_frame_t* frame) {
     // Handle system call based on syscall_number
     void* return_value = NULL;
 
-    // switch to kernel paging
+    // Enter the kernel landscape, the task's page directory stays loaded
     kernel_page();
 
     // Save the current task's state such as registers
@@ -57,7 +64,10 @@ void* isr80h_handler_c(int syscall_number, idt_interrupt_stack_frame_t* frame) {
     // Process the system call
     return_value = isr80h_handle_command(syscall_number, frame);
 
-    // Retrun to user pageing after syscall handling
+    // Drop the scratch buffers of the system call in one go
+    arena_reset(arena_scratch());
+
+    // Return to user mode segments, CR3 is only reloaded if the current task changed
     task_page_current();
 
     return return_value;
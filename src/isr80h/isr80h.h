@@ -13,6 +13,10 @@ typedef enum {
     ISR80H_CMD_PRINT,
     ISR80H_CMD_GET_KEYBOARD_CHAR,
     ISR80H_CMD_PUT_CHAR, // to terminal
+    ISR80H_CMD_FORK, // Clone the calling process, returns the child PID (0 in the child)
+    ISR80H_CMD_SHM_CREATE, // Create a shared memory region (size, &id), returns its address
+    ISR80H_CMD_SHM_ATTACH, // Attach a shared memory region (id), returns its address
+    ISR80H_CMD_SHM_DETACH, // Detach the shared memory region at an address (address)
 } isr80h_command_num_t;
 
 int isr80h_register_commands();
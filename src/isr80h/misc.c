@@ -1,9 +1,17 @@
 #include "misc.h"
 #include "task/task.h"
+#include "status.h"
 
 void* misc_isr80h_command_sum(idt_interrupt_stack_frame_t* frame) {
     // Extract the two integers from the stack frame
-    int var1 = (int)task_get_stack_item(task_get_current(), 0);
-    int var2 = (int)task_get_stack_item(task_get_current(), 1);
+    uint32_t var1 = 0;
+    uint32_t var2 = 0;
+    int res = task_get_stack_item(task_get_current(), 0, &var1);
+    if (res == ENONE) {
+        res = task_get_stack_item(task_get_current(), 1, &var2);
+    }
+    if (res != ENONE) {
+        return ERROR_VOID(res);
+    }
     return (void*)(var1 + var2);
 }
\ No newline at end of file
@@ -0,0 +1,27 @@
+#include "process.h"
+#include "task/task.h"
+#include "task/process.h"
+#include "status.h"
+
+/**
+ * @brief Handle the fork command from ISR 0x80.
+ *        The calling process is cloned copy-on-write, the child returns 0 from the system call.
+ * @param frame Pointer to the interrupt stack frame.
+ * @return The PID of the child in the parent, or negative error code on failure.
+ */
+void* process_isr80h_command_fork(idt_interrupt_stack_frame_t* frame) {
+    //////////////////////////////////////
+    // We are in kernel mode here
+    //////////////////////////////////////
+    task_t* current_task = task_get_current();
+    if (!frame || !current_task || !current_task->process) {
+        return ERROR_VOID(-EFAULT); // No current process
+    }
+
+    process_t* child = NULL;
+    int res = process_fork(current_task->process, &child);
+    if (res < 0) {
+        return ERROR_VOID(res);
+    }
+    return (void*)(int)child->pid;
+}
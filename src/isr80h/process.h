@@ -0,0 +1,9 @@
+#ifndef __ISR80H_PROCESS_H__
+#define __ISR80H_PROCESS_H__
+
+// Forward declaration
+typedef struct idt_interrupt_stack_frame idt_interrupt_stack_frame_t;
+
+void* process_isr80h_command_fork(idt_interrupt_stack_frame_t* frame);
+
+#endif // __ISR80H_PROCESS_H__
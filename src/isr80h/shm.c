@@ -0,0 +1,99 @@
+#include "shm.h"
+#include "task/task.h"
+#include "task/process.h"
+#include "memory/shm/shm.h"
+#include "memory/uaccess/uaccess.h"
+#include "status.h"
+
+/**
+ * @brief Handle the shared memory create command from ISR 0x80.
+ *        Arguments on the stack: the size in bytes, and a user pointer to store the id of the region.
+ *        The region is attached to the calling process.
+ * @param frame Pointer to the interrupt stack frame.
+ * @return The address the region is mapped at, or negative error code on failure.
+ */
+void* shm_isr80h_command_create(idt_interrupt_stack_frame_t* frame) {
+    //////////////////////////////////////
+    // We are in kernel mode here
+    //////////////////////////////////////
+    task_t* current_task = task_get_current();
+    if (!frame || !current_task || !current_task->process) {
+        return ERROR_VOID(-EFAULT); // No current process
+    }
+
+    uint32_t size = 0;
+    uint32_t id_ptr = 0;
+    int res = task_get_stack_item(current_task, 0, &size);
+    if (res == ENONE) {
+        res = task_get_stack_item(current_task, 1, &id_ptr);
+    }
+    if (res != ENONE) {
+        return ERROR_VOID(res);
+    }
+
+    shm_space_t* space = &current_task->process->shm;
+    uint32_t id = 0;
+    uint32_t address = 0;
+    res = shm_create(space, size, &id, &address);
+    if (res < 0) {
+        return ERROR_VOID(res);
+    }
+    res = copy_to_user((void*)id_ptr, &id, sizeof(id));
+    if (res < 0) {
+        shm_detach(space, address); // Nobody could attach it without the id
+        return ERROR_VOID(res);
+    }
+    return (void*)address;
+}
+
+/**
+ * @brief Handle the shared memory attach command from ISR 0x80.
+ *        Argument on the stack: the id of the region.
+ * @param frame Pointer to the interrupt stack frame.
+ * @return The address the region is mapped at, or negative error code on failure.
+ */
+void* shm_isr80h_command_attach(idt_interrupt_stack_frame_t* frame) {
+    //////////////////////////////////////
+    // We are in kernel mode here
+    //////////////////////////////////////
+    task_t* current_task = task_get_current();
+    if (!frame || !current_task || !current_task->process) {
+        return ERROR_VOID(-EFAULT); // No current process
+    }
+
+    uint32_t id = 0;
+    int res = task_get_stack_item(current_task, 0, &id);
+    if (res != ENONE) {
+        return ERROR_VOID(res);
+    }
+
+    uint32_t address = 0;
+    res = shm_attach(&current_task->process->shm, id, &address);
+    if (res < 0) {
+        return ERROR_VOID(res);
+    }
+    return (void*)address;
+}
+
+/**
+ * @brief Handle the shared memory detach command from ISR 0x80.
+ *        Argument on the stack: the address the region is mapped at.
+ * @param frame Pointer to the interrupt stack frame.
+ * @return ENONE on success, negative error code on failure.
+ */
+void* shm_isr80h_command_detach(idt_interrupt_stack_frame_t* frame) {
+    //////////////////////////////////////
+    // We are in kernel mode here
+    //////////////////////////////////////
+    task_t* current_task = task_get_current();
+    if (!frame || !current_task || !current_task->process) {
+        return ERROR_VOID(-EFAULT); // No current process
+    }
+
+    uint32_t address = 0;
+    int res = task_get_stack_item(current_task, 0, &address);
+    if (res != ENONE) {
+        return ERROR_VOID(res);
+    }
+    return ERROR_VOID(shm_detach(&current_task->process->shm, address));
+}
@@ -0,0 +1,11 @@
+#ifndef __ISR80H_SHM_H__
+#define __ISR80H_SHM_H__
+
+// Forward declaration
+typedef struct idt_interrupt_stack_frame idt_interrupt_stack_frame_t;
+
+void* shm_isr80h_command_create(idt_interrupt_stack_frame_t* frame);
+void* shm_isr80h_command_attach(idt_interrupt_stack_frame_t* frame);
+void* shm_isr80h_command_detach(idt_interrupt_stack_frame_t* frame);
+
+#endif // __ISR80H_SHM_H__
@@ -4,6 +4,10 @@
 #include "io/io.h"
 #include "memory/heap/kheap.h"
 #include "memory/paging/paging.h"
+#include "memory/vmalloc/vmalloc.h"
+#include "memory/arena/arena.h"
+#include "memory/zram/zram.h"
+#include "memory/frame/frame.h"
 #include "memory/memory.h"
 #include "disk/disk.h"
 #include "disk/streamer.h"
@@ -18,6 +22,7 @@
 static paging_4gb_chunk_t* kernel_paging_chunk = NULL;
 
 tss_t tss;
+static uint8_t kernel_interrupt_stack[KERNEL_INTERRUPT_STACK_SIZE_BYTES] __attribute__((aligned(16)));
 
 gdt_entry_t gdt_entries[GDT_MAX_ENTRIES];
 gdt_structured_t structured_gdt[GDT_MAX_ENTRIES] = {
@@ -54,8 +59,22 @@ void kernel_main() {
     gdt_init(gdt_entries, structured_gdt, GDT_MAX_ENTRIES);
     gdt_load(gdt_entries, sizeof(gdt_entries) - 1);
 
-    // Initialize the kernel heap
+    // Initialize the kernel heap, and the frame allocator with the RAM above it
     kheap_init();
+    if (frame_init(kheap_get_end(), kheap_get_memory_end()) != ENONE) {
+        panic("Not enough memory for the frame allocator.");
+    }
+
+    // Initialize the scratch arena for short-lived kernel buffers
+    if (arena_scratch_init() != ENONE) {
+        panic("Failed to initialize the scratch arena.");
+    }
+
+    // Initialize the compressed store for cold user pages and let processes feed it under memory pressure
+    if (zram_init() != ENONE) {
+        panic("Failed to initialize zram.");
+    }
+    process_init();
 
     // Initialize the Interrupt Descriptor Table (IDT)
     idt_init();
@@ -75,20 +94,31 @@ void kernel_main() {
     // Setup TSS
     memset(&tss, 0, sizeof(tss_t));
     tss.ss0 = KERNEL_DATA_SELECTOR;
-    tss.esp0 = KERNEL_HEAP_ADDRESS + KERNEL_HEAP_SIZE_BYTES; // Stack pointer for kernel mode
+    tss.esp0 = (uint32_t)kernel_interrupt_stack + sizeof(kernel_interrupt_stack); // Stack pointer for kernel mode
 
     // Load TSS segment into the task register
     tss_load(0x28); // TSS segment selector is at index 5
 
-    // Setup paging
-    uint8_t paging_flags = PAGING_FLAG_PRESENT | PAGING_FLAG_WRITABLE | PAGING_FLAG_USER;
+    // Setup paging. The kernel pages are shared by every task address space and kept global.
+    uint32_t paging_flags = PAGING_FLAG_PRESENT | PAGING_FLAG_WRITABLE | PAGING_FLAG_USER | PAGING_FLAG_GLOBAL;
     kernel_paging_chunk = paging_4gb_chunk_init(paging_flags);
 
-    // Switch to the new paging chunk
+    // Reserve the vmalloc window in the kernel address space
+    if (vmalloc_init(kernel_paging_chunk) != ENONE) {
+        panic("Failed to initialize vmalloc.");
+    }
+
+    // Switch to the new paging chunk, which maps large pages
+#if PAGING_PAE_ENABLED
+    paging_enable_pae();
+#else
+    paging_enable_large_pages();
+#endif
     paging_switch_4gb_chunk(kernel_paging_chunk);
 
     // Enable paging
     paging_enable();
+    paging_enable_global_pages();
 
     // Register ISR 0x80 commands
     if (isr80h_register_commands() != ENONE) {
@@ -120,15 +150,35 @@ void kernel_main() {
     // Kernel main function implementation
     while (1) {
         // Kernel loop
+        kernel_idle();
     }
 }
 
+/**
+ * @brief Do background work while no task has anything to do,
+ *        i.e. refill the pool of pre-zeroed frames in small steps.
+ */
+void kernel_idle() {
+    frame_zero_pool_refill(FRAME_ZERO_POOL_REFILL_FRAMES);
+}
+
+/**
+ * @brief Enter the kernel landscape after an interrupt or system call.
+ *        The kernel pages are mapped in every task address space, so the loaded page
+ *        directory is kept and only the segment registers are switched.
+ */
 void kernel_page() {
     if (!kernel_paging_chunk) {
         panic("Kernel paging chunk is not initialized.");
     }
     // Restore segment registers to the kernel data segment (DS, ES, FS, GS)
     kernel_restore_segment_registers_to_kernel_data();
-    // Switch to the kernel paging chunk
-    paging_switch_4gb_chunk(kernel_paging_chunk);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Get the kernel paging chunk, whose page tables every task address space shares.
+ * @return Pointer to the kernel paging chunk, or NULL before paging is set up.
+ */
+paging_4gb_chunk_t* kernel_get_paging_chunk() {
+    return kernel_paging_chunk;
+}
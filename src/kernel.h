@@ -1,9 +1,13 @@
 #ifndef __KERNEL_H__
 #define __KERNEL_H__
 
+typedef struct paging_4gb_chunk paging_4gb_chunk_t; // Forward declaration
+
 void panic(const char* message);
 void kernel_main();
 void kernel_page();
+void kernel_idle();
+paging_4gb_chunk_t* kernel_get_paging_chunk();
 
 /**
  * @brief Restore segment registers (DS, ES, FS, GS) to the kernel data segment.
@@ -0,0 +1,244 @@
+#include "arena.h"
+#include "memory/heap/kheap.h"
+#include "memory/memory.h"
+
+/**
+ * @file arena.c
+ * @brief Bump-pointer arenas on top of the kernel heap.
+ */
+
+static arena_t scratch_arena; // Kernel scratch arena, reset when a system call returns
+
+/**
+ * @brief Allocate a new chunk and push it in front of the chunk list.
+ * @param arena Pointer to the arena.
+ * @param min_size Minimum size of the chunk in bytes, including the header.
+ * @return Pointer to the new chunk, or NULL if the kernel heap is exhausted.
+ */
+static arena_chunk_t* arena_push_chunk(arena_t* arena, size_t min_size) {
+    size_t size = min_size > arena->chunk_size ? min_size : arena->chunk_size;
+
+    // Chunks are page aligned, so that page-aligned allocations only need padding inside the chunk
+    arena_chunk_t* chunk = (arena_chunk_t*)kheap_malloc_pages(size);
+    if (!chunk) {
+        return NULL;
+    }
+
+    chunk->next = arena->chunks;
+    chunk->size = size;
+    chunk->used = sizeof(arena_chunk_t);
+    arena->chunks = chunk;
+    return chunk;
+}
+
+/**
+ * @brief Free the current chunk of an arena and make the previous one current.
+ * @param arena Pointer to the arena.
+ */
+static void arena_pop_chunk(arena_t* arena) {
+    arena_chunk_t* chunk = arena->chunks;
+    arena->chunks = chunk->next;
+    kheap_free(chunk);
+}
+
+/**
+ * @brief Run and unlink the cleanups registered after a given one.
+ * @param arena Pointer to the arena.
+ * @param until The cleanup to stop at, or NULL to run all of them.
+ */
+static void arena_run_cleanups(arena_t* arena, arena_cleanup_t* until) {
+    while (arena->cleanups && arena->cleanups != until) {
+        arena_cleanup_t* cleanup = arena->cleanups;
+        arena->cleanups = cleanup->next;
+        cleanup->func(cleanup->data);
+    }
+}
+
+/**
+ * @brief Try to carve an allocation out of a chunk.
+ * @param chunk Pointer to the chunk, may be NULL.
+ * @param size The size of memory to allocate in bytes.
+ * @param alignment The alignment of the allocation, a power of two.
+ * @return Pointer to the allocated memory, or NULL if it does not fit.
+ */
+static void* arena_chunk_alloc(arena_chunk_t* chunk, size_t size, size_t alignment) {
+    if (!chunk) {
+        return NULL;
+    }
+
+    uintptr_t chunk_start = (uintptr_t)chunk;
+    uintptr_t start = (chunk_start + chunk->used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if (start - chunk_start > chunk->size || size > chunk->size - (start - chunk_start)) {
+        return NULL;
+    }
+
+    chunk->used = start - chunk_start + size;
+    return (void*)start;
+}
+
+/**
+ * @brief Initialize an arena. No memory is allocated until the first allocation.
+ * @param arena Pointer to the arena to initialize.
+ * @param chunk_size Default size of the chunks in bytes.
+ * @return ENONE if successful, error code otherwise (< 0).
+ */
+error_t arena_init(arena_t* arena, size_t chunk_size) {
+    if (!arena || chunk_size <= sizeof(arena_chunk_t)) {
+        return -EINVAL;
+    }
+
+    arena->chunks = NULL;
+    arena->chunk_size = chunk_size;
+    arena->cleanups = NULL;
+    return ENONE;
+}
+
+/**
+ * @brief Allocate memory from an arena with a given alignment.
+ * @param arena Pointer to the arena.
+ * @param size The size of memory to allocate in bytes.
+ * @param alignment The alignment of the allocation, a power of two (e.g. PAGE_SIZE).
+ * @return Pointer to the allocated memory, or NULL if allocation fails.
+ */
+void* arena_alloc_aligned(arena_t* arena, size_t size, size_t alignment) {
+    if (!arena || size == 0 || alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        return NULL;
+    }
+
+    void* ptr = arena_chunk_alloc(arena->chunks, size, alignment);
+    if (ptr) {
+        return ptr;
+    }
+
+    // Leave room for the header and the worst case padding
+    size_t min_size = sizeof(arena_chunk_t) + alignment - 1 + size;
+    if (min_size < size) {
+        return NULL; // Overflow
+    }
+    if (!arena_push_chunk(arena, min_size)) {
+        return NULL;
+    }
+    return arena_chunk_alloc(arena->chunks, size, alignment);
+}
+
+/**
+ * @brief Allocate memory from an arena.
+ * @param arena Pointer to the arena.
+ * @param size The size of memory to allocate in bytes.
+ * @return Pointer to the allocated memory aligned to ARENA_ALIGNMENT, or NULL if allocation fails.
+ */
+void* arena_alloc(arena_t* arena, size_t size) {
+    return arena_alloc_aligned(arena, size, ARENA_ALIGNMENT);
+}
+
+/**
+ * @brief Allocate zero-initialized memory from an arena.
+ * @param arena Pointer to the arena.
+ * @param size The size of memory to allocate in bytes.
+ * @return Pointer to the allocated memory aligned to ARENA_ALIGNMENT, or NULL if allocation fails.
+ */
+void* arena_zalloc(arena_t* arena, size_t size) {
+    void* ptr = arena_alloc(arena, size);
+    if (ptr) {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+/**
+ * @brief Get the current position of an arena.
+ * @param arena Pointer to the arena.
+ * @return The mark to pass to arena_release.
+ */
+arena_mark_t arena_get_mark(arena_t* arena) {
+    arena_mark_t mark = {
+        .chunk = arena->chunks,
+        .used = arena->chunks ? arena->chunks->used : 0,
+        .cleanups = arena->cleanups
+    };
+    return mark;
+}
+
+/**
+ * @brief Release everything allocated from an arena after a mark was taken.
+ *        Chunks pushed after the mark are freed. Marks must be released in LIFO order.
+ * @param arena Pointer to the arena.
+ * @param mark A mark returned by arena_get_mark.
+ */
+void arena_release(arena_t* arena, arena_mark_t mark) {
+    arena_run_cleanups(arena, mark.cleanups);
+    while (arena->chunks && arena->chunks != mark.chunk) {
+        arena_pop_chunk(arena);
+    }
+    if (arena->chunks) {
+        arena->chunks->used = mark.used;
+    }
+}
+
+/**
+ * @brief Release everything allocated from an arena, but keep its first chunk for reuse.
+ *        In the steady state this does not touch the kernel heap at all.
+ * @param arena Pointer to the arena.
+ */
+void arena_reset(arena_t* arena) {
+    arena_run_cleanups(arena, NULL);
+    while (arena->chunks && arena->chunks->next) {
+        arena_pop_chunk(arena);
+    }
+    if (arena->chunks) {
+        arena->chunks->used = sizeof(arena_chunk_t);
+    }
+}
+
+/**
+ * @brief Free all chunks of an arena. The arena can be used again afterwards.
+ * @param arena Pointer to the arena.
+ */
+void arena_destroy(arena_t* arena) {
+    arena_run_cleanups(arena, NULL);
+    while (arena->chunks) {
+        arena_pop_chunk(arena);
+    }
+}
+
+/**
+ * @brief Tie a resource to an arena, so that it is released together with the arena memory.
+ * @param arena Pointer to the arena.
+ * @param func Callback releasing the resource.
+ * @param data Pointer passed to the callback.
+ * @return ENONE if successful, error code otherwise (< 0).
+ */
+error_t arena_add_cleanup(arena_t* arena, arena_cleanup_func_t func, void* data) {
+    if (!arena || !func) {
+        return -EINVAL;
+    }
+
+    arena_cleanup_t* cleanup = (arena_cleanup_t*)arena_alloc(arena, sizeof(arena_cleanup_t));
+    if (!cleanup) {
+        return -ENOMEM;
+    }
+
+    cleanup->func = func;
+    cleanup->data = data;
+    cleanup->next = arena->cleanups;
+    arena->cleanups = cleanup;
+    return ENONE;
+}
+
+/**
+ * @brief Initialize the kernel scratch arena.
+ * @return ENONE if successful, error code otherwise (< 0).
+ */
+error_t arena_scratch_init() {
+    return arena_init(&scratch_arena, KERNEL_SCRATCH_ARENA_CHUNK_SIZE_BYTES);
+}
+
+/**
+ * @brief Get the kernel scratch arena for short-lived buffers.
+ *        It is reset when a system call returns. Code running outside of a system call
+ *        should release what it allocated with a mark (see arena_get_mark).
+ * @return Pointer to the scratch arena.
+ */
+arena_t* arena_scratch() {
+    return &scratch_arena;
+}
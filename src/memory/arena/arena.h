@@ -0,0 +1,74 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "status.h"
+#include "config.h"
+
+/**
+ * An arena is a bump allocator for memory which is released all at once:
+ * 1. Memory comes in chunks from the kernel heap. Each chunk starts with an arena_chunk_t
+ *    header and is filled front to back, so an allocation is a pointer increment.
+ * 2. When the current chunk is full a new one is pushed in front of the chunk list.
+ *    Requests larger than the chunk size get a chunk of their own.
+ * 3. Single allocations are never freed. A mark taken with arena_get_mark can be passed to
+ *    arena_release to drop everything allocated after it (LIFO), arena_reset drops
+ *    everything but keeps the first chunk for reuse, and arena_destroy frees all chunks.
+ * 4. Memory the arena cannot hold (e.g. vmalloc buffers) is tied to it with arena_add_cleanup.
+ *    Cleanups run in reverse order of registration whenever the memory holding them is released.
+ *
+ * The kernel keeps a scratch arena for short-lived buffers (see arena_scratch). It is reset
+ * when a system call returns, so anything allocated from it must not outlive the call.
+ */
+
+#define ARENA_ALIGNMENT 8 // Default alignment of arena allocations
+
+// Header at the start of every arena chunk
+typedef struct arena_chunk {
+    struct arena_chunk* next; // Previously filled chunk
+    size_t size;              // Size of the chunk in bytes, including this header
+    size_t used;              // Bytes in use, including this header
+} arena_chunk_t;
+
+/**
+ * @brief Callback releasing a resource tied to an arena.
+ * @param data The pointer passed to arena_add_cleanup.
+ */
+typedef void (*arena_cleanup_func_t)(void* data);
+
+// Cleanup record, allocated from the arena it belongs to
+typedef struct arena_cleanup {
+    arena_cleanup_func_t func;
+    void* data;
+    struct arena_cleanup* next; // Previously registered cleanup
+} arena_cleanup_t;
+
+typedef struct arena {
+    arena_chunk_t* chunks;     // Current chunk first
+    size_t chunk_size;         // Default size of new chunks in bytes
+    arena_cleanup_t* cleanups; // Most recently registered cleanup first
+} arena_t;
+
+// Position in an arena to release back to
+typedef struct arena_mark {
+    arena_chunk_t* chunk;
+    size_t used;
+    arena_cleanup_t* cleanups;
+} arena_mark_t;
+
+error_t arena_init(arena_t* arena, size_t chunk_size);
+void* arena_alloc(arena_t* arena, size_t size);
+void* arena_alloc_aligned(arena_t* arena, size_t size, size_t alignment);
+void* arena_zalloc(arena_t* arena, size_t size);
+arena_mark_t arena_get_mark(arena_t* arena);
+void arena_release(arena_t* arena, arena_mark_t mark);
+void arena_reset(arena_t* arena);
+void arena_destroy(arena_t* arena);
+error_t arena_add_cleanup(arena_t* arena, arena_cleanup_func_t func, void* data);
+
+// Kernel scratch arena
+error_t arena_scratch_init();
+arena_t* arena_scratch();
+
+#endif // __ARENA_H__
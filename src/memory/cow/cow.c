@@ -0,0 +1,163 @@
+#include "cow.h"
+#include "memory/heap/kheap.h"
+#include "memory/frame/frame.h"
+#include "memory/memory.h"
+
+/**
+ * @file cow.c
+ * @brief Copy-on-write sharing of user frames.
+ */
+
+// Share count of a frame mapped by more than one address space
+typedef struct cow_frame {
+    uint32_t frame;         // Physical address of the frame
+    uint32_t share_count;   // Number of page table entries mapping it, at least 2
+    struct cow_frame* next; // Next frame in the same bucket
+} cow_frame_t;
+
+static cow_frame_t* cow_frame_buckets[COW_FRAME_HASH_BUCKETS];
+
+/**
+ * @brief Get the bucket a frame is hashed into.
+ * @param frame Physical address of the frame.
+ * @return Pointer to the head pointer of the bucket.
+ */
+static cow_frame_t** cow_get_bucket(uint32_t frame) {
+    return &cow_frame_buckets[(frame / PAGE_SIZE) % COW_FRAME_HASH_BUCKETS];
+}
+
+/**
+ * @brief Find the share count of a frame.
+ * @param frame Physical address of the frame.
+ * @return Pointer to the share count entry, or NULL if the frame has a single owner.
+ */
+static cow_frame_t* cow_find_frame(uint32_t frame) {
+    for (cow_frame_t* entry = *cow_get_bucket(frame); entry; entry = entry->next) {
+        if (entry->frame == frame) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Share the frame of a page with a second address space, copy-on-write.
+ *        The page becomes read-only with PAGING_FLAG_COW in both address spaces. A page which
+ *        is not writable in the first place is copied instead, since it would never fault.
+ * @param from_chunk Pointer to the paging chunk which maps the page, with PAGING_FLAG_OWNED.
+ * @param to_chunk Pointer to the paging chunk to map the page into.
+ * @param virtual_address Page-aligned address of the page, the same in both address spaces.
+ * @return ENONE on success, -EINVAL if the page is not an owned present page, -ENOMEM on failure.
+ */
+int cow_share_page(paging_4gb_chunk_t* from_chunk, paging_4gb_chunk_t* to_chunk, uint32_t virtual_address) {
+    if (!from_chunk || !to_chunk) {
+        return -EINVAL;
+    }
+
+    paging_descriptor_entry_t entry = paging_get_page_entry(from_chunk, virtual_address);
+    if (!(entry & PAGING_FLAG_PRESENT) || !(entry & PAGING_FLAG_OWNED)) {
+        return -EINVAL;
+    }
+    uint32_t frame = PAGING_ENTRY_GET_ADDRESS(entry);
+
+    if (!(entry & (PAGING_FLAG_WRITABLE | PAGING_FLAG_COW))) {
+        void* copy = frame_alloc_colored(FRAME_GET_COLOR(virtual_address));
+        if (!copy) {
+            return -ENOMEM;
+        }
+        memcpy(copy, (void*)frame, PAGE_SIZE);
+        int res = paging_map_virtual_address(to_chunk, virtual_address, (uint32_t)copy | (entry & 0xFFF));
+        if (res < 0) {
+            frame_free(copy);
+        }
+        return res;
+    }
+
+    cow_frame_t* shared = cow_find_frame(frame);
+    if (!shared) {
+        shared = (cow_frame_t*)kheap_malloc(sizeof(cow_frame_t));
+        if (!shared) {
+            return -ENOMEM;
+        }
+        shared->frame = frame;
+        shared->share_count = 1;
+        cow_frame_t** bucket = cow_get_bucket(frame);
+        shared->next = *bucket;
+        *bucket = shared;
+    }
+
+    shared->share_count++;
+    paging_descriptor_entry_t cow_entry = (entry & ~(paging_descriptor_entry_t)PAGING_FLAG_WRITABLE) | PAGING_FLAG_COW;
+    int res = paging_map_virtual_address(to_chunk, virtual_address, cow_entry);
+    if (res < 0) {
+        cow_release_frame((void*)frame); // Undo the share, drops the entry if nobody else shares the frame
+        return res;
+    }
+    // The page already has a private table in from_chunk, so this does not fail
+    return paging_map_virtual_address(from_chunk, virtual_address, cow_entry);
+}
+
+/**
+ * @brief Resolve a write fault on a copy-on-write page.
+ *        The page gets a private copy of the frame, or keeps the frame if no other
+ *        address space maps it anymore, and becomes writable again.
+ * @param chunk Pointer to the paging chunk of the faulting address space.
+ * @param virtual_address The faulting address (any alignment).
+ * @return ENONE on success, -EFAULT if the page is not a COW page, -ENOMEM on failure.
+ */
+int cow_handle_write_fault(paging_4gb_chunk_t* chunk, uint32_t virtual_address) {
+    if (!chunk) {
+        return -EINVAL;
+    }
+
+    uint32_t page_address = virtual_address & ~(uint32_t)(PAGE_SIZE - 1);
+    paging_descriptor_entry_t entry = paging_get_page_entry(chunk, page_address);
+    if (!(entry & PAGING_FLAG_PRESENT) || !(entry & PAGING_FLAG_COW)) {
+        return -EFAULT;
+    }
+    uint32_t frame = PAGING_ENTRY_GET_ADDRESS(entry);
+    uint32_t flags = (entry & 0xFFF & ~PAGING_FLAG_COW) | PAGING_FLAG_WRITABLE;
+
+    if (!cow_find_frame(frame)) {
+        // The others copied the frame already, take it over
+        return paging_map_virtual_address(chunk, page_address, frame | flags);
+    }
+
+    void* copy = frame_alloc_colored(FRAME_GET_COLOR(virtual_address));
+    if (!copy) {
+        return -ENOMEM;
+    }
+    memcpy(copy, (void*)frame, PAGE_SIZE);
+
+    int res = paging_map_virtual_address(chunk, page_address, (uint32_t)copy | flags);
+    if (res < 0) {
+        frame_free(copy);
+        return res;
+    }
+    cow_release_frame((void*)frame); // Still mapped elsewhere, never the last reference
+    return ENONE;
+}
+
+/**
+ * @brief Drop one mapping of a frame owned by a COW page.
+ * @param frame Physical address of the frame.
+ * @return true if it was the last mapping and the caller must free the frame, false otherwise.
+ */
+bool cow_release_frame(void* frame) {
+    cow_frame_t** link = cow_get_bucket((uint32_t)frame);
+    while (*link && (*link)->frame != (uint32_t)frame) {
+        link = &(*link)->next;
+    }
+
+    cow_frame_t* shared = *link;
+    if (!shared) {
+        return true;
+    }
+
+    shared->share_count--;
+    if (shared->share_count <= 1) {
+        *link = shared->next; // Single owner left, who does not need an entry
+        kheap_free(shared);
+    }
+    return false;
+}
@@ -0,0 +1,27 @@
+#ifndef __COW_H__
+#define __COW_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "status.h"
+#include "memory/paging/paging.h"
+
+/**
+ * Copy-on-write sharing of user frames between address spaces (e.g. after a fork):
+ * 1. cow_share_page maps the frame of an owned page into a second address space. Both page
+ *    table entries lose PAGING_FLAG_WRITABLE and get PAGING_FLAG_COW, and keep PAGING_FLAG_OWNED.
+ * 2. Frames mapped more than once have a share count in a hash table. A frame which is not
+ *    in the table has a single owner, so plain owned pages cost nothing.
+ * 3. A write to a COW page faults and the page fault handler calls cow_handle_write_fault.
+ *    The page gets a private copy of the frame, or the frame itself if it is the last mapping.
+ * 4. Owners release COW frames with cow_release_frame and only free the frame if told so.
+ *
+ * zram leaves COW pages alone, since it would free a frame which others still map.
+ */
+
+int cow_share_page(paging_4gb_chunk_t* from_chunk, paging_4gb_chunk_t* to_chunk, uint32_t virtual_address);
+int cow_handle_write_fault(paging_4gb_chunk_t* chunk, uint32_t virtual_address);
+bool cow_release_frame(void* frame);
+
+#endif // __COW_H__
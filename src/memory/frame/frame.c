@@ -0,0 +1,362 @@
+#include "frame.h"
+#include "memory/memory.h"
+
+/**
+ * @file frame.c
+ * @brief Physical page frame allocator.
+ */
+
+static uintptr_t frame_region_start = 0;
+static uintptr_t frame_region_end = 0;
+static uintptr_t frame_untouched_end = 0;   // Frames from the start of the region up to here were never handed out
+static void* frame_free_lists[FRAME_CACHE_COLORS]; // Free frames per color, chained through their first word
+static void* frame_zero_lists[FRAME_CACHE_COLORS]; // Free pre-zeroed frames per color, chained the same way
+static uint32_t frame_zero_count = 0;       // Frames on the zero lists, counted as free
+static uint32_t frame_zero_next_color = 0;  // Color of the next frame zeroed by frame_zero_pool_refill
+static uint32_t frame_next_color = 0;       // Color of the next frame_alloc
+static frame_shrinker_t* frame_shrinkers = NULL;
+static bool frame_reclaiming = false;       // Shrinkers may free frames, but never allocate through reclaim again
+static frame_stats_t frame_stats;
+
+/**
+ * @brief Get the lowest start of the frame region the kernel heap can push it up to, for a given amount of RAM.
+ *        The frame allocator keeps at least 1/2^FRAME_RAM_SHARE_SHIFT of the RAM above KERNEL_HEAP_ADDRESS,
+ *        as long as the kernel heap can have KERNEL_HEAP_INITIAL_SIZE_BYTES.
+ * @param memory_end The end address of the RAM.
+ * @return The page-aligned address, memory_end if there is no room for frames.
+ */
+uintptr_t frame_get_region_start(uintptr_t memory_end) {
+    uintptr_t heap_minimum_end = KERNEL_HEAP_ADDRESS + KERNEL_HEAP_INITIAL_SIZE_BYTES;
+    if (memory_end <= heap_minimum_end) {
+        return memory_end;
+    }
+
+    uintptr_t start = (memory_end - ((memory_end - KERNEL_HEAP_ADDRESS) >> FRAME_RAM_SHARE_SHIFT)) &
+                      ~(uintptr_t)(PAGE_SIZE - 1);
+    return start < heap_minimum_end ? heap_minimum_end : start;
+}
+
+/**
+ * @brief Initialize the frame allocator with a region of the RAM.
+ * @param region_start Start address of the region, typically frame_get_region_start(memory_end).
+ * @param region_end End address of the region (exclusive).
+ * @return ENONE on success, -ENOMEM if the region holds no frame.
+ */
+error_t frame_init(uintptr_t region_start, uintptr_t region_end) {
+    memset(&frame_stats, 0, sizeof(frame_stats_t));
+    memset(frame_free_lists, 0, sizeof(frame_free_lists));
+    memset(frame_zero_lists, 0, sizeof(frame_zero_lists));
+    frame_zero_count = 0;
+    frame_zero_next_color = 0;
+    frame_region_start = (region_start + PAGE_SIZE - 1) & ~(uintptr_t)(PAGE_SIZE - 1);
+    frame_region_end = region_end & ~(uintptr_t)(PAGE_SIZE - 1);
+    if (frame_region_end <= frame_region_start) {
+        return -ENOMEM;
+    }
+
+    frame_untouched_end = frame_region_end;
+    frame_next_color = 0;
+    frame_stats.total_frames = (frame_region_end - frame_region_start) / PAGE_SIZE;
+    frame_stats.free_frames = frame_stats.total_frames;
+    return ENONE;
+}
+
+/**
+ * @brief Put a frame on the free list of its color.
+ * @param frame Pointer to the frame.
+ */
+static void frame_push(void* frame) {
+    void** list = &frame_free_lists[FRAME_GET_COLOR((uintptr_t)frame)];
+    *(void**)frame = *list;
+    *list = frame;
+}
+
+/**
+ * @brief Take the first frame off the free list of a color.
+ * @param color The color, less than FRAME_CACHE_COLORS.
+ * @return Pointer to the frame, or NULL if the list is empty.
+ */
+static void* frame_pop(uint32_t color) {
+    void* frame = frame_free_lists[color];
+    if (frame) {
+        frame_free_lists[color] = *(void**)frame;
+    }
+    return frame;
+}
+
+/**
+ * @brief Take the first frame off the zero list of a color.
+ * @param color The color, less than FRAME_CACHE_COLORS.
+ * @return Pointer to the frame, entirely zeroed, or NULL if the list is empty.
+ */
+static void* frame_zero_pop(uint32_t color) {
+    void* frame = frame_zero_lists[color];
+    if (frame) {
+        frame_zero_lists[color] = *(void**)frame;
+        *(void**)frame = NULL; // The link was the only non-zero word
+        frame_zero_count--;
+    }
+    return frame;
+}
+
+/**
+ * @brief Find a free frame of the given color: from its free list, else from the top of the untouched part
+ *        of the region (the frames skipped on the way go to the lists of their colors).
+ *        The untouched frames at the bottom stay free for the kernel heap as long as possible.
+ * @param color The wanted color, less than FRAME_CACHE_COLORS.
+ * @return Pointer to the frame, or NULL if there is none of the color. The counters are left alone.
+ */
+static void* frame_find(uint32_t color) {
+    void* frame = frame_pop(color);
+    while (!frame && frame_untouched_end > frame_region_start) {
+        frame_untouched_end -= PAGE_SIZE;
+        void* untouched = (void*)frame_untouched_end;
+        if (FRAME_GET_COLOR((uintptr_t)untouched) == color) {
+            frame = untouched;
+            break;
+        }
+        frame_push(untouched);
+    }
+    return frame;
+}
+
+/**
+ * @brief Count a frame taken off the free or zero lists as allocated.
+ */
+static void frame_account_alloc() {
+    frame_stats.free_frames--;
+    uint32_t used_frames = frame_stats.total_frames - frame_stats.free_frames;
+    if (used_frames > frame_stats.peak_used_frames) {
+        frame_stats.peak_used_frames = used_frames;
+    }
+}
+
+/**
+ * @brief Take a frame of the given color (see frame_find), else of any color,
+ *        else a pre-zeroed frame as a last resort.
+ * @param color The wanted color, less than FRAME_CACHE_COLORS.
+ * @return Pointer to the frame, or NULL if none is left.
+ */
+static void* frame_take(uint32_t color) {
+    void* frame = frame_find(color);
+
+    // Run out of the color, better a conflicting frame than none
+    for (uint32_t i = 1; !frame && i < FRAME_CACHE_COLORS; i++) {
+        frame = frame_pop((color + i) % FRAME_CACHE_COLORS);
+        frame_stats.color_fallbacks += frame ? 1 : 0;
+    }
+    for (uint32_t i = 0; !frame && frame_zero_count > 0 && i < FRAME_CACHE_COLORS; i++) {
+        frame = frame_zero_pop((color + i) % FRAME_CACHE_COLORS);
+        frame_stats.color_fallbacks += frame && i > 0 ? 1 : 0;
+    }
+    if (!frame) {
+        return NULL;
+    }
+
+    frame_account_alloc();
+    return frame;
+}
+
+/**
+ * @brief Allocate a physical page frame of a given color. The content is undefined.
+ *        When no frame is left, the shrinkers are called and the allocation is retried.
+ * @param color The wanted color, e.g. FRAME_GET_COLOR of the virtual address the frame is mapped at.
+ *        Reduced modulo FRAME_CACHE_COLORS.
+ * @return Pointer to the page-aligned frame, or NULL if allocation fails.
+ */
+void* frame_alloc_colored(uint32_t color) {
+    color %= FRAME_CACHE_COLORS;
+    void* frame = frame_take(color);
+    if (frame || frame_reclaiming) {
+        goto exit;
+    }
+
+    frame_reclaiming = true;
+    uint32_t reclaimed_frames = 0;
+    for (frame_shrinker_t* shrinker = frame_shrinkers; shrinker && reclaimed_frames < FRAME_RECLAIM_BATCH_FRAMES; shrinker = shrinker->next) {
+        reclaimed_frames += shrinker->reclaim(FRAME_RECLAIM_BATCH_FRAMES - reclaimed_frames, shrinker->data);
+    }
+    frame_reclaiming = false;
+    frame_stats.reclaimed_frames += reclaimed_frames;
+    frame = frame_take(color);
+
+exit:
+    if (!frame) {
+        frame_stats.failed_allocations++;
+    }
+    return frame;
+}
+
+/**
+ * @brief Allocate a physical page frame. The content is undefined.
+ *        Successive frames get successive colors.
+ * @return Pointer to the page-aligned frame, or NULL if allocation fails.
+ */
+void* frame_alloc() {
+    return frame_alloc_colored(frame_next_color++);
+}
+
+/**
+ * @brief Allocate a physical page frame of a given color filled with zeros.
+ *        A pre-zeroed frame of the color is taken if there is one, otherwise the frame is zeroed now.
+ * @param color The wanted color, see frame_alloc_colored.
+ * @return Pointer to the page-aligned frame, or NULL if allocation fails.
+ */
+void* frame_zalloc_colored(uint32_t color) {
+    color %= FRAME_CACHE_COLORS;
+    void* frame = frame_zero_pop(color);
+    if (frame) {
+        frame_account_alloc();
+        return frame;
+    }
+
+    frame = frame_alloc_colored(color);
+    if (frame) {
+        memset(frame, 0, PAGE_SIZE);
+    }
+    return frame;
+}
+
+/**
+ * @brief Allocate a physical page frame filled with zeros.
+ *        Any pre-zeroed frame is taken, starting with the color frame_alloc would use.
+ * @return Pointer to the page-aligned frame, or NULL if allocation fails.
+ */
+void* frame_zalloc() {
+    uint32_t color = frame_next_color++;
+    for (uint32_t i = 0; frame_zero_count > 0 && i < FRAME_CACHE_COLORS; i++) {
+        void* frame = frame_zero_pop((color + i) % FRAME_CACHE_COLORS);
+        if (frame) {
+            frame_account_alloc();
+            return frame;
+        }
+    }
+    return frame_zalloc_colored(color);
+}
+
+/**
+ * @brief Zero free frames ahead of time for frame_zalloc and frame_zalloc_colored.
+ *        Meant to be called while the kernel is idle, the batch size bounds the time spent.
+ *        The colors take turns, so each has pre-zeroed frames for the user pages of its color.
+ *        Pooled frames stay free: frame_alloc takes them back when nothing else is left.
+ * @param max_frames Maximum number of frames to zero in this call.
+ * @return The number of frames added to the pool.
+ */
+uint32_t frame_zero_pool_refill(uint32_t max_frames) {
+    uint32_t added_frames = 0;
+    uint32_t empty_colors = 0;
+    while (added_frames < max_frames && frame_zero_count < FRAME_ZERO_POOL_FRAMES && empty_colors < FRAME_CACHE_COLORS) {
+        uint32_t color = frame_zero_next_color;
+        frame_zero_next_color = (color + 1) % FRAME_CACHE_COLORS;
+        void* frame = frame_find(color);
+        if (!frame) {
+            empty_colors++;
+            continue;
+        }
+
+        empty_colors = 0;
+        memset(frame, 0, PAGE_SIZE);
+        void** list = &frame_zero_lists[color];
+        *(void**)frame = *list;
+        *list = frame;
+        frame_zero_count++;
+        added_frames++;
+    }
+    return added_frames;
+}
+
+/**
+ * @brief Give a frame back to the allocator.
+ * @param frame Pointer to a frame returned by one of the frame allocation functions, may be NULL.
+ */
+void frame_free(void* frame) {
+    uintptr_t address = (uintptr_t)frame;
+    if (!frame || address < frame_untouched_end || address >= frame_region_end || (address & (PAGE_SIZE - 1))) {
+        return; // Not a frame of ours
+    }
+
+    frame_push(frame);
+    frame_stats.free_frames++;
+}
+
+/**
+ * @brief Extend the frame region downwards, e.g. with the memory the kernel heap shrank away from.
+ *        The new frames are untouched. Ignored before frame_init.
+ * @param region_start The new start of the region, below the current one and page-aligned.
+ */
+void frame_extend_region(uintptr_t region_start) {
+    if (frame_region_end == 0 || region_start >= frame_region_start || (region_start & (PAGE_SIZE - 1))) {
+        return;
+    }
+
+    // The untouched frames stay in one piece, they start at the bottom of the region
+    uint32_t added_frames = (frame_region_start - region_start) / PAGE_SIZE;
+    frame_region_start = region_start;
+    frame_stats.total_frames += added_frames;
+    frame_stats.free_frames += added_frames;
+}
+
+/**
+ * @brief Give the bottom of the frame region back, e.g. for the kernel heap to grow into.
+ *        Only untouched frames can be given back, so the region may shrink less than asked for.
+ * @param region_start The wanted new start of the region, page-aligned.
+ * @return The new start of the region. Everything below it is free to use for the caller.
+ *         Before frame_init, region_start itself.
+ */
+uintptr_t frame_shrink_region(uintptr_t region_start) {
+    if (frame_region_end == 0) {
+        return region_start;
+    }
+    if (region_start > frame_untouched_end) {
+        region_start = frame_untouched_end;
+    }
+    if (region_start <= frame_region_start) {
+        return frame_region_start;
+    }
+
+    uint32_t removed_frames = (region_start - frame_region_start) / PAGE_SIZE;
+    frame_region_start = region_start;
+    frame_stats.total_frames -= removed_frames;
+    frame_stats.free_frames -= removed_frames;
+    return region_start;
+}
+
+/**
+ * @brief Get the number of untouched frames at the bottom of the region,
+ *        i.e. how far frame_shrink_region could give the region back right now.
+ * @return The number of untouched frames, 0 before frame_init.
+ */
+uint32_t frame_get_untouched_frames() {
+    return (frame_untouched_end - frame_region_start) / PAGE_SIZE;
+}
+
+/**
+ * @brief Register a shrinker which is called when the frame allocator runs out of frames.
+ *        Shrinkers are called in registration order.
+ * @param shrinker Pointer to the shrinker, owned by the caller.
+ */
+void frame_register_shrinker(frame_shrinker_t* shrinker) {
+    if (!shrinker || !shrinker->reclaim) {
+        return;
+    }
+
+    frame_shrinker_t** link = &frame_shrinkers;
+    while (*link) {
+        if (*link == shrinker) {
+            return; // Already registered
+        }
+        link = &(*link)->next;
+    }
+    shrinker->next = NULL;
+    *link = shrinker;
+}
+
+/**
+ * @brief Get the counters of the frame allocator.
+ * @param stats Pointer to store the statistics.
+ */
+void frame_get_stats(frame_stats_t* stats) {
+    if (stats) {
+        *stats = frame_stats;
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef __FRAME_H__
+#define __FRAME_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "config.h"
+#include "status.h"
+
+/**
+ * The frame allocator hands out single physical pages for user memory and kernel page tables,
+ * so that they do not compete with kernel objects in the kernel heap:
+ * 1. It owns the RAM above the kernel heap. The region is identity mapped by the kernel paging
+ *    chunk like the heap. Its border with the heap moves: the frames the heap shrinks away from
+ *    are added to the region (frame_extend_region), and the heap grows by taking untouched frames
+ *    back from the bottom of the region (frame_shrink_region), at most up to frame_get_region_start.
+ * 2. Free frames are chained through their first word, in one list per page color. Frames never
+ *    handed out yet are taken from the top of the untouched part at the bottom of the region, so
+ *    nothing is set up at boot and the heap can take the untouched part back. Allocation and free are O(1), O(FRAME_CACHE_COLORS) at worst.
+ * 3. The color of a frame is its page number modulo FRAME_CACHE_COLORS, which selects a slice of
+ *    the sets of a physically indexed cache. User pages ask for the color of their virtual page
+ *    (frame_alloc_colored), so consecutive pages of a process never compete for the same sets.
+ *    Other frames rotate through the colors. Another color is only used when the wanted one ran out.
+ * 4. Up to FRAME_ZERO_POOL_FRAMES free frames are zeroed ahead of time while the kernel is idle
+ *    (frame_zero_pool_refill), on zero lists per color. frame_zalloc and frame_zalloc_colored take
+ *    from them, so page tables, shared memory and fresh user pages are not zeroed on the spot.
+ *    Pooled frames count as free and are handed out as plain frames when nothing else is left.
+ * 5. When no frame is left, the registered shrinkers are asked to free some (e.g. by
+ *    compressing cold user pages into zram), and the allocation is retried.
+ */
+
+/**
+ * @brief Called when the frame allocator runs out of frames.
+ * @param num_frames Number of frames the allocator would like to get back.
+ * @param data The data pointer of the shrinker.
+ * @return The number of frames freed with frame_free.
+ */
+typedef uint32_t (*frame_reclaim_func_t)(uint32_t num_frames, void* data);
+
+// Reclaim callback registered with frame_register_shrinker. Owned by the caller.
+typedef struct frame_shrinker {
+    frame_reclaim_func_t reclaim;
+    void* data;                  // Passed to the callback
+    struct frame_shrinker* next; // Next registered shrinker
+} frame_shrinker_t;
+
+// Counters of the frame allocator
+typedef struct frame_stats {
+    uint32_t total_frames;       // Frames of the region
+    uint32_t free_frames;        // Frames not allocated, including the untouched ones
+    uint32_t peak_used_frames;   // Highest number of frames allocated at once
+    uint32_t failed_allocations; // Allocations which could not be satisfied
+    uint32_t reclaimed_frames;   // Frames given back by the shrinkers
+    uint32_t color_fallbacks;    // Colored allocations served with another color
+} frame_stats_t;
+
+// Color of the page containing an address, physical or virtual
+#define FRAME_GET_COLOR(address) (((address) / PAGE_SIZE) % FRAME_CACHE_COLORS)
+
+uintptr_t frame_get_region_start(uintptr_t memory_end);
+error_t frame_init(uintptr_t region_start, uintptr_t region_end);
+void* frame_alloc();
+void* frame_alloc_colored(uint32_t color);
+void* frame_zalloc();
+void* frame_zalloc_colored(uint32_t color);
+uint32_t frame_zero_pool_refill(uint32_t max_frames);
+void frame_free(void* frame);
+void frame_extend_region(uintptr_t region_start);
+uintptr_t frame_shrink_region(uintptr_t region_start);
+uint32_t frame_get_untouched_frames();
+void frame_register_shrinker(frame_shrinker_t* shrinker);
+void frame_get_stats(frame_stats_t* stats);
+
+#endif // __FRAME_H__
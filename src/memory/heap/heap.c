@@ -10,16 +10,30 @@
 
 #define HEAP_INVALID_BLOCK_INDEX (uint32_t)0xFFFFFFFF
 
+/**
+ * @brief Header of a free run, stored in the first block of the run itself.
+ *        The number of blocks is mirrored in the last word of the run's last block
+ *        (the footer) so that a block being freed can find the start of its left neighbour.
+ */
+typedef struct heap_free_run {
+    uint32_t num_blocks; // Length of the run in blocks
+    uint32_t next;       // Block index of the next run in the same free list
+    uint32_t prev;       // Block index of the previous run in the same free list
+} heap_free_run_t;
+_Static_assert((1U << HEAP_MIN_BLOCK_SIZE_SHIFT) >= sizeof(heap_free_run_t) + sizeof(uint32_t),
+               "The smallest heap block must hold a free run header and footer");
+
  /**
   * @brief Validate the heap block table.
+  * @param heap Pointer to the heap structure, with its block size already set.
   * @param table Pointer to the heap block table.
   * @param start_ptr Start address of the heap.
   * @param end_ptr End address of the heap.
   * @return ENONE if valid, error code otherwise.
   */
-static error_t heap_validate_table(heap_table_t* table, void* start_ptr, void* end_ptr) {
+static error_t heap_validate_table(heap_t* heap, heap_table_t* table, void* start_ptr, void* end_ptr) {
     size_t total_size = (size_t)((uintptr_t)end_ptr - (uintptr_t)start_ptr);
-    size_t expected_blocks = total_size / KERNEL_HEAP_BLOCK_SIZE;
+    size_t expected_blocks = total_size >> heap->block_size_shift;
     if (table->total_blocks != expected_blocks) {
         return -EINVAL;
     }
@@ -28,45 +42,12 @@ static error_t heap_validate_table(heap_table_t* table, void* start_ptr, void* e
 
  /**
   * @brief Validate if a pointer is aligned to the heap block size.
+  * @param heap Pointer to the heap structure.
   * @param ptr Pointer to validate.
   * @return true if aligned, false otherwise.
   */
-static bool heap_validate_alignment(void* ptr) {
-    return ((intptr_t)ptr % KERNEL_HEAP_BLOCK_SIZE) == 0;
-}
-
-/**
- * @brief Find the first free block index of a chunk of contiguous blocks in the heap for allocation.
- * @param heap Pointer to the heap structure.
- * @param num_blocks Number of contiguous blocks needed.
- * @return The starting block index if found, HEAP_INVALID_BLOCK_INDEX otherwise.
- */
-static uint32_t heap_get_start_block_index(heap_t* heap, uint32_t num_blocks) {
-    uint32_t bs = HEAP_INVALID_BLOCK_INDEX; // block start
-    uint32_t bc = 0; // block count
-    heap_table_t* table = heap->table;
-
-    // Iterate through the heap block entries to find a suitable chunk
-    for (uint32_t i = 0; i < table->total_blocks; i++) {
-        heap_block_entry_t entry = table->entries[i];
-        if (HEAP_GET_ENTRY_TYPE(entry) != HEAP_BLOCK_TYPE_FREE) {
-            // Reset if a used/reserved block is encountered.
-            // This manner ensures only contiguous free blocks are considered.
-            bs = HEAP_INVALID_BLOCK_INDEX;
-            bc = 0;
-            continue;
-        }
-        if (bs == HEAP_INVALID_BLOCK_INDEX) {
-            bs = i; // Mark the start of a potential chunk
-        }
-        bc++;
-        if (bc == num_blocks) {
-            // Found a suitable chunk
-            break;
-        }
-    }
-
-    return bs;
+static bool heap_validate_alignment(heap_t* heap, void* ptr) {
+    return ((uintptr_t)ptr & HEAP_GET_BLOCK_MASK(heap)) == 0;
 }
 
 /**
@@ -76,7 +57,7 @@ static uint32_t heap_get_start_block_index(heap_t* heap, uint32_t num_blocks) {
  * @return The memory address of the block.
  */
 static void* heap_get_block_address(heap_t* heap, uint32_t block_index) {
-    return (void*)((uintptr_t)heap->start_address + (block_index * KERNEL_HEAP_BLOCK_SIZE));
+    return (void*)((uintptr_t)heap->start_address + ((uintptr_t)block_index << heap->block_size_shift));
 }
 
 /**
@@ -86,17 +67,128 @@ static void* heap_get_block_address(heap_t* heap, uint32_t block_index) {
  * @return The block index.
  */
 static uint32_t heap_get_block_index(heap_t* heap, void* ptr) {
-    return (uint32_t)(((uintptr_t)ptr - (uintptr_t)heap->start_address) / KERNEL_HEAP_BLOCK_SIZE);
+    return (uint32_t)(((uintptr_t)ptr - (uintptr_t)heap->start_address) >> heap->block_size_shift);
 }
 
 /**
- * @brief Mark a range of blocks as used in the heap block table.
+ * @brief Get the free list class of a run, i.e. floor(log2(num_blocks)).
+ * @param num_blocks Length of the run in blocks (must be > 0).
+ * @return The index of the free list holding runs of this length.
+ */
+static inline uint32_t heap_get_free_list_class(uint32_t num_blocks) {
+    return 31 - (uint32_t)__builtin_clz(num_blocks);
+}
+
+/**
+ * @brief Get the header of the free run starting at a block index.
+ * @param heap Pointer to the heap structure.
+ * @param block_index The first block of the run.
+ * @return Pointer to the run header stored in the block.
+ */
+static inline heap_free_run_t* heap_get_free_run(heap_t* heap, uint32_t block_index) {
+    return (heap_free_run_t*)heap_get_block_address(heap, block_index);
+}
+
+/**
+ * @brief Get the footer of a free run, i.e. the last word of its last block.
+ * @param heap Pointer to the heap structure.
+ * @param last_block The last block of the run.
+ * @return Pointer to the footer holding the run length.
+ */
+static inline uint32_t* heap_get_free_run_footer(heap_t* heap, uint32_t last_block) {
+    uintptr_t block_end = (uintptr_t)heap_get_block_address(heap, last_block) + HEAP_GET_BLOCK_SIZE(heap);
+    return (uint32_t*)(block_end - sizeof(uint32_t));
+}
+
+/**
+ * @brief Insert a run of free blocks into the free list of its class.
+ * @param heap Pointer to the heap structure.
+ * @param start_block The first block of the run.
+ * @param num_blocks Length of the run in blocks.
+ */
+static void heap_free_list_insert(heap_t* heap, uint32_t start_block, uint32_t num_blocks) {
+    uint32_t class = heap_get_free_list_class(num_blocks);
+    heap_free_run_t* run = heap_get_free_run(heap, start_block);
+
+    run->num_blocks = num_blocks;
+    run->prev = HEAP_INVALID_BLOCK_INDEX;
+    run->next = heap->free_lists[class];
+    *heap_get_free_run_footer(heap, start_block + num_blocks - 1) = num_blocks;
+
+    if (run->next != HEAP_INVALID_BLOCK_INDEX) {
+        heap_get_free_run(heap, run->next)->prev = start_block;
+    }
+    heap->free_lists[class] = start_block;
+    heap->free_list_bitmap |= (1U << class);
+}
+
+/**
+ * @brief Unlink a run of free blocks from the free list of its class.
+ * @param heap Pointer to the heap structure.
+ * @param start_block The first block of the run.
+ * @return Length of the removed run in blocks.
+ */
+static uint32_t heap_free_list_remove(heap_t* heap, uint32_t start_block) {
+    heap_free_run_t* run = heap_get_free_run(heap, start_block);
+    uint32_t class = heap_get_free_list_class(run->num_blocks);
+
+    if (run->prev != HEAP_INVALID_BLOCK_INDEX) {
+        heap_get_free_run(heap, run->prev)->next = run->next;
+    } else {
+        heap->free_lists[class] = run->next;
+    }
+    if (run->next != HEAP_INVALID_BLOCK_INDEX) {
+        heap_get_free_run(heap, run->next)->prev = run->prev;
+    }
+
+    if (heap->free_lists[class] == HEAP_INVALID_BLOCK_INDEX) {
+        heap->free_list_bitmap &= ~(1U << class);
+    }
+    return run->num_blocks;
+}
+
+/**
+ * @brief Find a run of free blocks large enough for an allocation.
+ *        Every run kept in a class above floor(log2(num_blocks)) is guaranteed to fit,
+ *        so the smallest such non-empty class is picked straight from the bitmap.
+ *        Only when all of those are empty is the run list of the request's own class searched,
+ *        up to HEAP_FREE_LIST_FALLBACK_RUNS runs so that the search stays O(1) however long it is.
  * @param heap Pointer to the heap structure.
+ * @param num_blocks Number of contiguous blocks needed.
+ * @return The first block index of a suitable run if found, HEAP_INVALID_BLOCK_INDEX otherwise.
+ */
+static uint32_t heap_get_start_block_index(heap_t* heap, uint32_t num_blocks) {
+    uint32_t class = heap_get_free_list_class(num_blocks);
+
+    // A power-of-two request is satisfied by any run of its own class
+    uint32_t first_fitting_class = (num_blocks & (num_blocks - 1)) == 0 ? class : class + 1;
+    uint32_t candidates = first_fitting_class < HEAP_FREE_LIST_COUNT
+        ? heap->free_list_bitmap & ~((1U << first_fitting_class) - 1)
+        : 0;
+    if (candidates) {
+        return heap->free_lists[__builtin_ctz(candidates)];
+    }
+
+    // Fall back to the runs which share the class of the request but may still be long enough
+    uint32_t block_index = heap->free_lists[class];
+    for (uint32_t i = 0; i < HEAP_FREE_LIST_FALLBACK_RUNS && block_index != HEAP_INVALID_BLOCK_INDEX; i++) {
+        heap_free_run_t* run = heap_get_free_run(heap, block_index);
+        if (run->num_blocks >= num_blocks) {
+            return block_index;
+        }
+        block_index = run->next;
+    }
+
+    return HEAP_INVALID_BLOCK_INDEX;
+}
+
+/**
+ * @brief Write the entries of a new allocation into the heap block table.
+ * @param table Pointer to the heap block table.
  * @param start_block The starting block index.
- * @param num_blocks The number of blocks to mark as used.
+ * @param num_blocks The number of blocks in the allocation.
  */
-static void heap_mark_blocks_used(heap_t* heap, uint32_t start_block, uint32_t num_blocks) {
-    heap_table_t* table = heap->table;
+static void heap_table_set_used(heap_table_t* table, uint32_t start_block, uint32_t num_blocks) {
     for (uint32_t i = 0; i < num_blocks; i++) {
         uint8_t entry = HEAP_BLOCK_TYPE_USED;
         if (i == 0) {
@@ -110,12 +202,12 @@ static void heap_mark_blocks_used(heap_t* heap, uint32_t start_block, uint32_t n
 }
 
 /**
- * @brief Mark a range of blocks as free in the heap block table.
- * @param heap Pointer to the heap structure.
- * @param start_block The starting block index.
+ * @brief Clear the entries of an allocation in the heap block table by following its HAS_NEXT chain.
+ * @param table Pointer to the heap block table.
+ * @param start_block The first block of the allocation.
+ * @return The number of blocks released.
  */
-static void heap_mark_blocks_free(heap_t* heap, uint32_t start_block) {
-    heap_table_t* table = heap->table;
+static uint32_t heap_table_set_free(heap_table_t* table, uint32_t start_block) {
     uint32_t current_block = start_block;
 
     while (true) {
@@ -129,34 +221,390 @@ static void heap_mark_blocks_free(heap_t* heap, uint32_t start_block) {
             break; // No more blocks in this allocation
         }
     }
+
+    return current_block - start_block + 1;
+}
+
+/**
+ * @brief Mark a range of blocks as used in the heap block table.
+ *        The range must start at the first block of a free run. The run is taken
+ *        out of the free-run index and whatever is left of it is put back.
+ * @param heap Pointer to the heap structure.
+ * @param start_block The starting block index.
+ * @param num_blocks The number of blocks to mark as used.
+ */
+static void heap_mark_blocks_used(heap_t* heap, uint32_t start_block, uint32_t num_blocks) {
+    // Split the free run and return the remainder to the index
+    uint32_t run_blocks = heap_free_list_remove(heap, start_block);
+    if (run_blocks > num_blocks) {
+        heap_free_list_insert(heap, start_block + num_blocks, run_blocks - num_blocks);
+    }
+
+    heap_table_set_used(heap->table, start_block, num_blocks);
+}
+
+/**
+ * @brief Mark a range of blocks as free in the heap block table.
+ *        The released blocks are coalesced with free neighbouring runs on both sides
+ *        before the merged run is inserted into the free-run index.
+ * @param heap Pointer to the heap structure.
+ * @param start_block The starting block index.
+ */
+static void heap_mark_blocks_free(heap_t* heap, uint32_t start_block) {
+    heap_table_t* table = heap->table;
+    uint32_t num_blocks = heap_table_set_free(table, start_block);
+
+    // Coalesce with the free run on the left, found through its footer
+    if (start_block > 0 && HEAP_GET_ENTRY_TYPE(table->entries[start_block - 1]) == HEAP_BLOCK_TYPE_FREE) {
+        uint32_t left_blocks = *heap_get_free_run_footer(heap, start_block - 1);
+        start_block -= left_blocks;
+        heap_free_list_remove(heap, start_block);
+        num_blocks += left_blocks;
+    }
+
+    // Coalesce with the free run on the right, found through its header
+    uint32_t next_block = start_block + num_blocks;
+    if (next_block < table->total_blocks && HEAP_GET_ENTRY_TYPE(table->entries[next_block]) == HEAP_BLOCK_TYPE_FREE) {
+        num_blocks += heap_free_list_remove(heap, next_block);
+    }
+
+    heap_free_list_insert(heap, start_block, num_blocks);
+}
+
+/**
+ * @brief Get the order of the largest naturally aligned power-of-two chunk
+ *        which starts at a block and does not extend past the end of a range.
+ * @param block_index The first block of the chunk.
+ * @param end_block The end of the range (exclusive).
+ * @return The order of the chunk.
+ */
+static uint32_t heap_buddy_get_chunk_order(uint32_t block_index, uint32_t end_block) {
+    uint32_t order = heap_get_free_list_class(end_block - block_index);
+    if (block_index > 0 && (uint32_t)__builtin_ctz(block_index) < order) {
+        order = (uint32_t)__builtin_ctz(block_index);
+    }
+    return order;
+}
+
+/**
+ * @brief Seed the buddy free lists with the largest naturally aligned power-of-two
+ *        chunks which tile the heap. A heap size which is not a power of two simply
+ *        yields a few chunks of decreasing order at the tail.
+ * @param heap Pointer to the heap structure.
+ */
+static void heap_buddy_init(heap_t* heap) {
+    uint32_t total_blocks = heap->table->total_blocks;
+    uint32_t block_index = 0;
+
+    while (block_index < total_blocks) {
+        uint32_t order = heap_buddy_get_chunk_order(block_index, total_blocks);
+        heap_free_list_insert(heap, block_index, 1U << order);
+        block_index += 1U << order;
+    }
+}
+
+/**
+ * @brief Allocate a buddy block of at least num_blocks blocks.
+ *        The smallest non-empty order which fits is found through the bitmap
+ *        and split in halves down to the requested order, O(log n).
+ * @param heap Pointer to the heap structure.
+ * @param num_blocks Number of contiguous blocks needed.
+ * @return The first block index of the allocation if found, HEAP_INVALID_BLOCK_INDEX otherwise.
+ */
+static uint32_t heap_buddy_malloc_blocks(heap_t* heap, uint32_t num_blocks) {
+    uint32_t order = heap_get_free_list_class(num_blocks);
+    if ((num_blocks & (num_blocks - 1)) != 0) {
+        order++; // Round up to the next power of two
+    }
+    if (order >= HEAP_FREE_LIST_COUNT) {
+        return HEAP_INVALID_BLOCK_INDEX;
+    }
+
+    uint32_t candidates = heap->free_list_bitmap & ~((1U << order) - 1);
+    if (!candidates) {
+        return HEAP_INVALID_BLOCK_INDEX;
+    }
+
+    uint32_t current_order = (uint32_t)__builtin_ctz(candidates);
+    uint32_t start_block = heap->free_lists[current_order];
+    heap_free_list_remove(heap, start_block);
+
+    // Give the upper halves back until the block has the requested order
+    while (current_order > order) {
+        current_order--;
+        heap_free_list_insert(heap, start_block + (1U << current_order), 1U << current_order);
+    }
+
+    heap_table_set_used(heap->table, start_block, 1U << order);
+    return start_block;
+}
+
+/**
+ * @brief Free a buddy block and merge it with its buddy as long as the buddy is
+ *        a free block of the same order, O(log n).
+ * @param heap Pointer to the heap structure.
+ * @param start_block The first block of the allocation.
+ */
+static void heap_buddy_free_blocks(heap_t* heap, uint32_t start_block) {
+    heap_table_t* table = heap->table;
+    uint32_t num_blocks = heap_table_set_free(table, start_block);
+
+    while (true) {
+        uint32_t buddy_block = start_block ^ num_blocks;
+        if (buddy_block + num_blocks > table->total_blocks ||
+            HEAP_GET_ENTRY_TYPE(table->entries[buddy_block]) != HEAP_BLOCK_TYPE_FREE ||
+            heap_get_free_run(heap, buddy_block)->num_blocks != num_blocks) {
+            break;
+        }
+
+        heap_free_list_remove(heap, buddy_block);
+        if (buddy_block < start_block) {
+            start_block = buddy_block;
+        }
+        num_blocks <<= 1;
+    }
+
+    heap_free_list_insert(heap, start_block, num_blocks);
 }
 
 /**
  * @brief Align a value to the upper multiple of the heap block size.
+ * @param heap Pointer to the heap structure.
  * @param val The value to align.
- * @return The aligned value.
+ * @return The aligned value, or 0 if it does not fit in 32 bits.
+ */
+static uint32_t heap_align_value_to_upper(heap_t* heap, size_t val) {
+    return (uint32_t)((val + HEAP_GET_BLOCK_MASK(heap)) & ~(size_t)HEAP_GET_BLOCK_MASK(heap));
+}
+
+/**
+ * @brief Hand a range of blocks which are not indexed yet over to the allocator as free memory.
+ *        The range is coalesced with the free memory around it like a regular free.
+ * @param heap Pointer to the heap structure.
+ * @param start_block The first block of the range.
+ * @param num_blocks Length of the range in blocks.
  */
-static uint32_t heap_align_value_to_upper(size_t val) {
-    if (val % KERNEL_HEAP_BLOCK_SIZE == 0) {
-        return (uint32_t)val;
+static void heap_release_blocks(heap_t* heap, uint32_t start_block, uint32_t num_blocks) {
+    if (heap->backend != HEAP_BACKEND_BUDDY) {
+        heap_table_set_used(heap->table, start_block, num_blocks);
+        heap_mark_blocks_free(heap, start_block);
+        return;
+    }
+
+    // The buddy backend only frees naturally aligned power-of-two chunks. All of them are
+    // marked used before the first is freed, so no merge can pick up a stale run header.
+    uint32_t end_block = start_block + num_blocks;
+    for (uint32_t block_index = start_block; block_index < end_block; ) {
+        uint32_t chunk_blocks = 1U << heap_buddy_get_chunk_order(block_index, end_block);
+        heap_table_set_used(heap->table, block_index, chunk_blocks);
+        block_index += chunk_blocks;
+    }
+    for (uint32_t block_index = start_block; block_index < end_block; ) {
+        uint32_t chunk_blocks = 1U << heap_buddy_get_chunk_order(block_index, end_block);
+        heap_buddy_free_blocks(heap, block_index);
+        block_index += chunk_blocks;
     }
-    return (uint32_t)((val / KERNEL_HEAP_BLOCK_SIZE) + 1) * KERNEL_HEAP_BLOCK_SIZE;
 }
 
 /**
- * @brief Allocate a chunk of contiguous blocks in the heap.
+ * @brief Count the blocks of an allocation by following its HAS_NEXT chain.
+ * @param table Pointer to the heap block table.
+ * @param start_block The first block of the allocation.
+ * @return The number of blocks in the allocation.
+ */
+static uint32_t heap_get_allocation_num_blocks(heap_table_t* table, uint32_t start_block) {
+    uint32_t block_index = start_block;
+    while (table->entries[block_index] & HEAP_BLOCK_FLAG_HAS_NEXT) {
+        block_index++;
+    }
+    return block_index - start_block + 1;
+}
+
+/**
+ * @brief Resize an allocation in place with the free list backend.
+ *        Shrinking cuts the HAS_NEXT chain and frees the tail, growing takes
+ *        the front of the free run right after the allocation.
+ * @param heap Pointer to the heap structure.
+ * @param start_block The first block of the allocation.
+ * @param current_blocks The current length of the allocation in blocks.
+ * @param num_blocks The requested length in blocks.
+ * @return true if the allocation now has num_blocks blocks, false if it has to move.
+ */
+static bool heap_resize_blocks(heap_t* heap, uint32_t start_block, uint32_t current_blocks, uint32_t num_blocks) {
+    if (num_blocks < current_blocks) {
+        heap_table_set_used(heap->table, start_block, num_blocks);
+        heap_release_blocks(heap, start_block + num_blocks, current_blocks - num_blocks);
+        return true;
+    }
+    if (num_blocks == current_blocks) {
+        return true;
+    }
+
+    uint32_t next_block = start_block + current_blocks;
+    if (next_block >= heap->table->total_blocks ||
+        HEAP_GET_ENTRY_TYPE(heap->table->entries[next_block]) != HEAP_BLOCK_TYPE_FREE ||
+        heap_get_free_run(heap, next_block)->num_blocks < num_blocks - current_blocks) {
+        return false;
+    }
+
+    uint32_t run_blocks = heap_free_list_remove(heap, next_block);
+    uint32_t taken_blocks = num_blocks - current_blocks;
+    if (run_blocks > taken_blocks) {
+        heap_free_list_insert(heap, next_block + taken_blocks, run_blocks - taken_blocks);
+    }
+    heap_table_set_used(heap->table, start_block, num_blocks);
+    return true;
+}
+
+/**
+ * @brief Resize an allocation in place with the buddy backend.
+ *        Shrinking gives upper halves back, growing merges the block with its
+ *        free buddies on the right as long as the block stays at its position.
+ * @param heap Pointer to the heap structure.
+ * @param start_block The first block of the allocation.
+ * @param current_blocks The current length of the allocation in blocks (a power of two).
+ * @param num_blocks The requested length in blocks.
+ * @return true if the allocation now holds at least num_blocks blocks, false if it has to move.
+ */
+static bool heap_buddy_resize_blocks(heap_t* heap, uint32_t start_block, uint32_t current_blocks, uint32_t num_blocks) {
+    heap_table_t* table = heap->table;
+
+    if (num_blocks <= current_blocks) {
+        uint32_t kept_blocks = current_blocks;
+        while (kept_blocks / 2 >= num_blocks) {
+            kept_blocks /= 2;
+        }
+        if (kept_blocks < current_blocks) {
+            heap_table_set_used(table, start_block, kept_blocks);
+            heap_release_blocks(heap, start_block + kept_blocks, current_blocks - kept_blocks);
+        }
+        return true;
+    }
+
+    // Check that every buddy up to the requested order is free before touching any of them
+    uint32_t merged_blocks = current_blocks;
+    while (merged_blocks < num_blocks) {
+        uint32_t buddy_block = start_block ^ merged_blocks;
+        if (buddy_block < start_block ||
+            buddy_block + merged_blocks > table->total_blocks ||
+            HEAP_GET_ENTRY_TYPE(table->entries[buddy_block]) != HEAP_BLOCK_TYPE_FREE ||
+            heap_get_free_run(heap, buddy_block)->num_blocks != merged_blocks) {
+            return false;
+        }
+        merged_blocks <<= 1;
+    }
+
+    for (uint32_t blocks = current_blocks; blocks < merged_blocks; blocks <<= 1) {
+        heap_free_list_remove(heap, start_block + blocks);
+    }
+    heap_table_set_used(table, start_block, merged_blocks);
+    return true;
+}
+
+/**
+ * @brief Update the used block counters after an allocation changed its size.
+ * @param heap Pointer to the heap structure.
+ * @param old_blocks Length of the allocation before, 0 for a new allocation.
+ * @param new_blocks Length of the allocation after, 0 for a freed allocation.
+ */
+static void heap_account_blocks(heap_t* heap, uint32_t old_blocks, uint32_t new_blocks) {
+    heap->stats.used_blocks = heap->stats.used_blocks - old_blocks + new_blocks;
+    if (heap->stats.used_blocks > heap->stats.peak_used_blocks) {
+        heap->stats.peak_used_blocks = heap->stats.used_blocks;
+    }
+}
+
+/**
+ * @brief Find and reserve a chunk of contiguous blocks with the heap's backend.
  * @param heap Pointer to the heap structure.
  * @param num_blocks Number of contiguous blocks needed.
- * @return Pointer to the starting address of the allocated memory, or NULL if allocation fails.
+ * @return The first block index of the allocation if found, HEAP_INVALID_BLOCK_INDEX otherwise.
  */
-static void* heap_malloc_blocks(heap_t* heap, uint32_t num_blocks) {
+static uint32_t heap_allocate_blocks(heap_t* heap, uint32_t num_blocks) {
+    if (heap->backend == HEAP_BACKEND_BUDDY) {
+        return heap_buddy_malloc_blocks(heap, num_blocks);
+    }
+
     uint32_t start_block = heap_get_start_block_index(heap, num_blocks);
     if (start_block == HEAP_INVALID_BLOCK_INDEX) {
-        return NULL; // No suitable chunk found
+        return HEAP_INVALID_BLOCK_INDEX; // No suitable chunk found
     }
 
     // Mark the blocks as used
     heap_mark_blocks_used(heap, start_block, num_blocks);
+    return start_block;
+}
+
+/**
+ * @brief Get the headroom of a heap, i.e. the blocks allocations could still get.
+ *        These are the free active blocks, plus the reserved blocks the grow handler could
+ *        bring into use: as many as its growable handler reports, the whole reserved tail
+ *        without one. A heap without a grow handler cannot grow.
+ * @param heap Pointer to the heap structure.
+ * @return The headroom in blocks.
+ */
+uint32_t heap_get_headroom(heap_t* heap) {
+    uint32_t headroom = heap->active_blocks - heap->stats.used_blocks;
+    if (heap->grow_handler) {
+        uint32_t reserved_blocks = heap->table->total_blocks - heap->active_blocks;
+        uint32_t growable_blocks = heap->growable_handler ? heap->growable_handler(heap) : reserved_blocks;
+        headroom += growable_blocks < reserved_blocks ? growable_blocks : reserved_blocks;
+    }
+    return headroom;
+}
+
+/**
+ * @brief Allocate a chunk of contiguous blocks, giving the grow handler one chance to add blocks.
+ * @param heap Pointer to the heap structure.
+ * @param num_blocks Number of contiguous blocks needed.
+ * @return The first block index of the allocation if found, HEAP_INVALID_BLOCK_INDEX otherwise.
+ */
+static uint32_t heap_allocate_or_grow_blocks(heap_t* heap, uint32_t num_blocks) {
+    uint32_t start_block = heap_allocate_blocks(heap, num_blocks);
+    if (start_block == HEAP_INVALID_BLOCK_INDEX && heap->grow_handler && heap->grow_handler(heap, num_blocks) > 0) {
+        start_block = heap_allocate_blocks(heap, num_blocks);
+    }
+    return start_block;
+}
+
+/**
+ * @brief Allocate a chunk of contiguous blocks in the heap.
+ *        If nothing fits, the heap's grow handler gets one chance to add blocks, then the
+ *        shrinkers are asked to give memory back and the allocation is retried once more.
+ *        As a last resort the movable allocations are compacted before the final retry.
+ * @param heap Pointer to the heap structure.
+ * @param num_blocks Number of contiguous blocks needed.
+ * @return Pointer to the starting address of the allocated memory, or NULL if allocation fails.
+ */
+static void* heap_malloc_blocks(heap_t* heap, uint32_t num_blocks) {
+    uint32_t start_block = heap_allocate_or_grow_blocks(heap, num_blocks);
+    if (start_block == HEAP_INVALID_BLOCK_INDEX) {
+        uint32_t headroom = heap_get_headroom(heap);
+        uint32_t target_blocks = heap->high_watermark > headroom ? heap->high_watermark - headroom : 0;
+        if (heap_reclaim(heap, target_blocks > num_blocks ? target_blocks : num_blocks) > 0) {
+            start_block = heap_allocate_or_grow_blocks(heap, num_blocks);
+        }
+    }
+    if (start_block == HEAP_INVALID_BLOCK_INDEX && heap_compact(heap) > 0) {
+        start_block = heap_allocate_or_grow_blocks(heap, num_blocks);
+    }
+    if (start_block == HEAP_INVALID_BLOCK_INDEX) {
+        heap->stats.failed_allocations++;
+        return NULL;
+    }
+
+    // The buddy backend hands out the request rounded up to a power of two
+    if (heap->backend == HEAP_BACKEND_BUDDY && (num_blocks & (num_blocks - 1)) != 0) {
+        num_blocks = 2U << heap_get_free_list_class(num_blocks);
+    }
+    heap_account_blocks(heap, 0, num_blocks);
+    heap->stats.allocations++;
+
+    // Refill the headroom before the next allocations run into a failure
+    uint32_t headroom = heap_get_headroom(heap);
+    if (headroom < heap->low_watermark) {
+        heap_reclaim(heap, heap->high_watermark - headroom);
+    }
 
     // Return the starting address of the allocated memory
     return heap_get_block_address(heap, start_block);
@@ -168,17 +616,32 @@ static void* heap_malloc_blocks(heap_t* heap, uint32_t num_blocks) {
   * @param start_ptr Start address of the heap.
   * @param end_ptr End address of the heap.
   * @param table Pointer to the heap block table.
+  * @param backend Allocation policy of the heap, see heap_backend_t.
+  * @param block_size_shift log2 of the block size, from HEAP_MIN_BLOCK_SIZE_SHIFT
+  *        (e.g. 6 for a 64-byte heap) to HEAP_MAX_BLOCK_SIZE_SHIFT.
   * @return ENONE if successful, error code otherwise (< 0).
   */
-error_t heap_init(heap_t* heap, void* start_ptr, void* end_ptr, heap_table_t* table) {
+error_t heap_init(heap_t* heap, void* start_ptr, void* end_ptr, heap_table_t* table, heap_backend_t backend, uint32_t block_size_shift) {
     error_t err = ENONE;
+    if (backend != HEAP_BACKEND_FREE_LIST && backend != HEAP_BACKEND_BUDDY) {
+        err = -EINVAL;
+        goto exit;
+    }
+
+    // A free block must be able to hold the free run header and footer
+    if (block_size_shift < HEAP_MIN_BLOCK_SIZE_SHIFT || block_size_shift > HEAP_MAX_BLOCK_SIZE_SHIFT) {
+        err = -EINVAL;
+        goto exit;
+    }
+    heap->block_size_shift = block_size_shift;
+
     // Validate the heap block table
-    if ((err = heap_validate_table(table, start_ptr, end_ptr)) != ENONE) {
+    if ((err = heap_validate_table(heap, table, start_ptr, end_ptr)) != ENONE) {
         goto exit;
     }
 
     // Validate the start and end pointers alignment
-    if (!heap_validate_alignment(start_ptr) || !heap_validate_alignment(end_ptr)) {
+    if (!heap_validate_alignment(heap, start_ptr) || !heap_validate_alignment(heap, end_ptr)) {
         err = -EINVAL;
         goto exit;
     }
@@ -186,15 +649,71 @@ error_t heap_init(heap_t* heap, void* start_ptr, void* end_ptr, heap_table_t* ta
     // Initialize the heap structure
     heap->table = table;
     heap->start_address = start_ptr;
+    heap->backend = backend;
+    heap->active_blocks = table->total_blocks;
+    heap->grow_handler = NULL;
+    heap->growable_handler = NULL;
+    heap->shrinkers = NULL;
+    heap->low_watermark = 0;
+    heap->high_watermark = 0;
+    heap->reclaiming = false;
+    heap->movables = NULL;
+    memset(&heap->stats, 0, sizeof(heap_stats_t));
 
     // Mark all blocks as free in the heap block table
     size_t table_size = table->total_blocks * sizeof(heap_block_entry_t);
     memset((void*)table->entries, 0, table_size);
 
+    // Start with empty free lists and index the whole heap
+    for (uint32_t i = 0; i < HEAP_FREE_LIST_COUNT; i++) {
+        heap->free_lists[i] = HEAP_INVALID_BLOCK_INDEX;
+    }
+    heap->free_list_bitmap = 0;
+    if (backend == HEAP_BACKEND_BUDDY) {
+        heap_buddy_init(heap);
+    } else if (table->total_blocks > 0) {
+        heap_free_list_insert(heap, 0, table->total_blocks); // A single run
+    }
+
 exit:
     return err;
 }
 
+/**
+ * @brief Get the first block of a live allocation from its start pointer.
+ *        Only the first block of a live allocation is accepted. Anything else
+ *        (double free, foreign pointer) would corrupt the free-run index.
+ * @param heap Pointer to the heap structure.
+ * @param ptr Pointer to the start of the allocation.
+ * @param block_index Pointer to store the block index.
+ * @return ENONE if the pointer is an allocation start, -EINVAL otherwise.
+ */
+static error_t heap_get_allocation_block_index(heap_t* heap, void* ptr, uint32_t* block_index) {
+    // Validate the pointer alignment
+    if (!heap_validate_alignment(heap, ptr)) {
+        printf("Invalid pointer alignment: %p\n", ptr);
+
+        /* TODO: Handle error (e.g., errcode, exception) */
+
+        return -EINVAL;
+    }
+
+    // Get the block index corresponding to the pointer
+    *block_index = heap_get_block_index(heap, ptr);
+
+    if ((uintptr_t)ptr < (uintptr_t)heap->start_address || *block_index >= heap->table->total_blocks) {
+        printf("Pointer out of heap range: %p\n", ptr);
+        return -EINVAL;
+    }
+    heap_block_entry_t entry = heap->table->entries[*block_index];
+    if (HEAP_GET_ENTRY_TYPE(entry) != HEAP_BLOCK_TYPE_USED || !(entry & HEAP_BLOCK_FLAG_IS_FIRST)) {
+        printf("Pointer is not an allocation start: %p\n", ptr);
+        return -EINVAL;
+    }
+
+    return ENONE;
+}
+
 /**
  * @brief Allocate memory from the general heap.
  * @param heap Pointer to the heap structure.
@@ -202,11 +721,18 @@ exit:
  * @return Pointer to the allocated memory, or NULL if allocation fails.
  */
 void* heap_malloc(heap_t* heap, size_t size) {
+    if (size == 0) {
+        return NULL;
+    }
+
     // Align the size to the upper multiple of the heap block size
-    size = heap_align_value_to_upper(size);
+    size = heap_align_value_to_upper(heap, size);
 
     // Calculate the number of blocks needed
-    uint32_t num_blocks = size / KERNEL_HEAP_BLOCK_SIZE;
+    uint32_t num_blocks = size >> heap->block_size_shift;
+    if (num_blocks == 0) {
+        return NULL; // The request overflowed while being aligned
+    }
 
     // Allocate the blocks
     return heap_malloc_blocks(heap, num_blocks);
@@ -218,18 +744,407 @@ void* heap_malloc(heap_t* heap, size_t size) {
  * @param ptr Pointer to the memory to free.
  */
 void heap_free(heap_t* heap, void* ptr) {
-    // Validate the pointer alignment
-    if (!heap_validate_alignment(ptr)) {
-        printf("Invalid pointer alignment: %p\n", ptr);
+    uint32_t block_index;
+    if (heap_get_allocation_block_index(heap, ptr, &block_index) != ENONE) {
+        return; // Invalid pointer, do nothing
+    }
 
-        /* TODO: Handle error (e.g., errcode, exception) */
+    heap_account_blocks(heap, heap_get_allocation_num_blocks(heap->table, block_index), 0);
+    heap->stats.frees++;
 
-        return; // Invalid pointer, do nothing
+    // Mark the blocks as free
+    if (heap->backend == HEAP_BACKEND_BUDDY) {
+        heap_buddy_free_blocks(heap, block_index);
+    } else {
+        heap_mark_blocks_free(heap, block_index);
+    }
+}
+
+/**
+ * @brief Resize an allocation of the general heap.
+ *        The allocation is shrunk or extended in place whenever the blocks after it allow,
+ *        and only moved (allocate, copy, free) as a fallback.
+ * @param heap Pointer to the heap structure.
+ * @param ptr Pointer to the allocation to resize, or NULL to allocate.
+ * @param size The new size in bytes, or 0 to free.
+ * @return Pointer to the resized allocation, or NULL if it fails (the old allocation is left untouched).
+ */
+void* heap_realloc(heap_t* heap, void* ptr, size_t size) {
+    if (!ptr) {
+        return heap_malloc(heap, size);
+    }
+    if (size == 0) {
+        heap_free(heap, ptr);
+        return NULL;
+    }
+
+    uint32_t block_index;
+    if (heap_get_allocation_block_index(heap, ptr, &block_index) != ENONE) {
+        return NULL;
+    }
+
+    uint32_t num_blocks = heap_align_value_to_upper(heap, size) >> heap->block_size_shift;
+    if (num_blocks == 0) {
+        return NULL; // The request overflowed while being aligned
+    }
+
+    uint32_t current_blocks = heap_get_allocation_num_blocks(heap->table, block_index);
+    bool resized = heap->backend == HEAP_BACKEND_BUDDY
+        ? heap_buddy_resize_blocks(heap, block_index, current_blocks, num_blocks)
+        : heap_resize_blocks(heap, block_index, current_blocks, num_blocks);
+    if (resized) {
+        heap_account_blocks(heap, current_blocks, heap_get_allocation_num_blocks(heap->table, block_index));
+        return ptr;
+    }
+
+    // Move the allocation as a last resort, which only happens when it grows
+    void* new_ptr = heap_malloc(heap, size);
+    if (!new_ptr) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, (size_t)current_blocks << heap->block_size_shift);
+    heap_free(heap, ptr);
+    return new_ptr;
+}
+
+/**
+ * @brief Find the start of the live allocation which contains a pointer.
+ *        The block table is walked back from the pointer's block to the IS_FIRST block.
+ * @param heap Pointer to the heap structure.
+ * @param ptr Any pointer into an allocation.
+ * @return The start address of the allocation, or NULL if the pointer is not inside a live allocation.
+ */
+void* heap_get_allocation_start(heap_t* heap, void* ptr) {
+    if ((uintptr_t)ptr < (uintptr_t)heap->start_address) {
+        return NULL;
     }
 
-    // Get the block index corresponding to the pointer
     uint32_t block_index = heap_get_block_index(heap, ptr);
+    if (block_index >= heap->table->total_blocks) {
+        return NULL;
+    }
 
-    // Mark the blocks as free
-    heap_mark_blocks_free(heap, block_index);
-}
\ No newline at end of file
+    heap_block_entry_t* entries = heap->table->entries;
+    if (HEAP_GET_ENTRY_TYPE(entries[block_index]) != HEAP_BLOCK_TYPE_USED) {
+        return NULL;
+    }
+    while (!(entries[block_index] & HEAP_BLOCK_FLAG_IS_FIRST)) {
+        block_index--;
+    }
+
+    return heap_get_block_address(heap, block_index);
+}
+
+/**
+ * @brief Bring blocks from the reserved tail of the block table into use.
+ *        The new blocks are merged with a free run at the current end of the heap.
+ *        The caller is responsible for the memory behind them being accessible.
+ * @param heap Pointer to the heap structure.
+ * @param num_blocks Number of blocks to add.
+ * @return The number of blocks added, which is less than requested when the table is exhausted.
+ */
+uint32_t heap_grow(heap_t* heap, uint32_t num_blocks) {
+    uint32_t reserved_blocks = heap->table->total_blocks - heap->active_blocks;
+    if (num_blocks > reserved_blocks) {
+        num_blocks = reserved_blocks;
+    }
+    if (num_blocks == 0) {
+        return 0;
+    }
+
+    uint32_t start_block = heap->active_blocks;
+    heap->active_blocks += num_blocks;
+    heap_release_blocks(heap, start_block, num_blocks);
+
+    return num_blocks;
+}
+
+/**
+ * @brief Give free blocks at the end of the heap back to the reserved tail of the block table.
+ *        Free runs are trimmed from the end until enough blocks are released or a used block is hit.
+ * @param heap Pointer to the heap structure.
+ * @param num_blocks Maximum number of blocks to release.
+ * @return The number of blocks released. The memory behind them is no longer touched by the heap.
+ */
+uint32_t heap_shrink(heap_t* heap, uint32_t num_blocks) {
+    heap_block_entry_t* entries = heap->table->entries;
+    uint32_t released_blocks = 0;
+
+    while (released_blocks < num_blocks && heap->active_blocks > 0) {
+        uint32_t last_block = heap->active_blocks - 1;
+        if (HEAP_GET_ENTRY_TYPE(entries[last_block]) != HEAP_BLOCK_TYPE_FREE) {
+            break;
+        }
+
+        // Take the last free run out of the index and cut the released part off its end
+        uint32_t run_blocks = *heap_get_free_run_footer(heap, last_block);
+        uint32_t run_start = heap->active_blocks - run_blocks;
+        heap_free_list_remove(heap, run_start);
+
+        uint32_t release_blocks = run_blocks;
+        if (release_blocks > num_blocks - released_blocks) {
+            release_blocks = num_blocks - released_blocks;
+        }
+        heap->active_blocks -= release_blocks;
+        memset(&entries[heap->active_blocks], HEAP_BLOCK_TYPE_RESERVED, release_blocks * sizeof(heap_block_entry_t));
+        released_blocks += release_blocks;
+
+        if (release_blocks < run_blocks) {
+            heap_release_blocks(heap, run_start, run_blocks - release_blocks);
+        }
+    }
+
+    return released_blocks;
+}
+
+/**
+ * @brief Get the number of free blocks at the end of the active range of the heap,
+ *        i.e. how many blocks heap_shrink could release right now.
+ * @param heap Pointer to the heap structure.
+ * @return The number of free tail blocks.
+ */
+uint32_t heap_get_tail_free_blocks(heap_t* heap) {
+    heap_block_entry_t* entries = heap->table->entries;
+    uint32_t block_index = heap->active_blocks;
+
+    // A single maximal run with the free list backend, possibly several buddy blocks
+    while (block_index > 0 && HEAP_GET_ENTRY_TYPE(entries[block_index - 1]) == HEAP_BLOCK_TYPE_FREE) {
+        block_index -= *heap_get_free_run_footer(heap, block_index - 1);
+    }
+
+    return heap->active_blocks - block_index;
+}
+
+/**
+ * @brief Get the usage counters and free space metrics of a heap.
+ *        The free space metrics walk the free lists, so this is O(number of free runs).
+ * @param heap Pointer to the heap structure.
+ * @param stats Pointer to store the statistics.
+ */
+void heap_get_stats(heap_t* heap, heap_stats_t* stats) {
+    *stats = heap->stats;
+    stats->total_blocks = heap->active_blocks;
+    stats->free_blocks = 0;
+    stats->free_runs = 0;
+    stats->largest_free_run = 0;
+
+    for (uint32_t class = 0; class < HEAP_FREE_LIST_COUNT; class++) {
+        uint32_t block_index = heap->free_lists[class];
+        while (block_index != HEAP_INVALID_BLOCK_INDEX) {
+            heap_free_run_t* run = heap_get_free_run(heap, block_index);
+            stats->free_blocks += run->num_blocks;
+            stats->free_runs++;
+            if (run->num_blocks > stats->largest_free_run) {
+                stats->largest_free_run = run->num_blocks;
+            }
+            block_index = run->next;
+        }
+    }
+
+    // Scale both down if needed so that the percentage does not overflow
+    uint32_t largest_free_run = stats->largest_free_run;
+    uint32_t free_blocks = stats->free_blocks;
+    while (largest_free_run > 0xFFFFFFFF / 100) {
+        largest_free_run >>= 1;
+        free_blocks >>= 1;
+    }
+    stats->fragmentation = free_blocks > 0 ? 100 - largest_free_run * 100 / free_blocks : 0;
+}
+
+/**
+ * @brief Register a shrinker, called when the heap runs short of memory.
+ * @param heap Pointer to the heap structure.
+ * @param shrinker Pointer to the shrinker, owned by the caller until it is unregistered.
+ */
+void heap_register_shrinker(heap_t* heap, heap_shrinker_t* shrinker) {
+    if (!heap || !shrinker || !shrinker->reclaim) {
+        return;
+    }
+
+    // Append, so that shrinkers are called in registration order
+    heap_shrinker_t** link = &heap->shrinkers;
+    while (*link) {
+        if (*link == shrinker) {
+            return; // Already registered
+        }
+        link = &(*link)->next;
+    }
+    shrinker->next = NULL;
+    *link = shrinker;
+}
+
+/**
+ * @brief Unregister a shrinker.
+ * @param heap Pointer to the heap structure.
+ * @param shrinker Pointer to the shrinker.
+ */
+void heap_unregister_shrinker(heap_t* heap, heap_shrinker_t* shrinker) {
+    if (!heap || !shrinker) {
+        return;
+    }
+
+    heap_shrinker_t** link = &heap->shrinkers;
+    while (*link && *link != shrinker) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = shrinker->next;
+        shrinker->next = NULL;
+    }
+}
+
+/**
+ * @brief Set the watermarks driving the shrinkers of a heap.
+ *        When the headroom drops below low_blocks after an allocation, the shrinkers are asked
+ *        to bring it back to high_blocks. Both 0 (the default) only reclaim on allocation failure.
+ * @param heap Pointer to the heap structure.
+ * @param low_blocks Low watermark in blocks.
+ * @param high_blocks High watermark in blocks, raised to low_blocks if lower.
+ */
+void heap_set_watermarks(heap_t* heap, uint32_t low_blocks, uint32_t high_blocks) {
+    heap->low_watermark = low_blocks;
+    heap->high_watermark = high_blocks > low_blocks ? high_blocks : low_blocks;
+}
+
+/**
+ * @brief Ask the registered shrinkers to give memory back to the heap.
+ *        Shrinkers are called in registration order until num_blocks blocks are freed.
+ * @param heap Pointer to the heap structure.
+ * @param num_blocks Number of blocks to reclaim.
+ * @return The number of blocks the shrinkers freed.
+ */
+uint32_t heap_reclaim(heap_t* heap, uint32_t num_blocks) {
+    if (!heap || !heap->shrinkers || num_blocks == 0 || heap->reclaiming) {
+        return 0;
+    }
+
+    heap->reclaiming = true;
+    heap->stats.reclaims++;
+
+    uint32_t reclaimed_blocks = 0;
+    for (heap_shrinker_t* shrinker = heap->shrinkers; shrinker && reclaimed_blocks < num_blocks; shrinker = shrinker->next) {
+        reclaimed_blocks += shrinker->reclaim(heap, num_blocks - reclaimed_blocks, shrinker->data);
+    }
+
+    heap->stats.reclaimed_blocks += reclaimed_blocks;
+    heap->reclaiming = false;
+    return reclaimed_blocks;
+}
+
+/**
+ * @brief Allocate movable memory from the general heap.
+ *        The allocation may be moved by heap_compact whenever its handle is not pinned,
+ *        so it must only be accessed between heap_pin and heap_unpin.
+ * @param heap Pointer to the heap structure.
+ * @param handle Pointer to the handle, owned by the caller until heap_free_movable.
+ * @param size The size of memory to allocate in bytes.
+ * @return ENONE if successful, error code otherwise (< 0).
+ */
+error_t heap_malloc_movable(heap_t* heap, heap_handle_t* handle, size_t size) {
+    if (!heap || !handle) {
+        return -EINVAL;
+    }
+
+    handle->ptr = heap_malloc(heap, size);
+    if (!handle->ptr) {
+        return -ENOMEM;
+    }
+    handle->pin_count = 0;
+
+    // Keep the list sorted by address, which is the order compaction moves allocations in
+    heap_handle_t** link = &heap->movables;
+    while (*link && (uintptr_t)(*link)->ptr < (uintptr_t)handle->ptr) {
+        link = &(*link)->next;
+    }
+    handle->next = *link;
+    *link = handle;
+    return ENONE;
+}
+
+/**
+ * @brief Free a movable allocation.
+ * @param heap Pointer to the heap structure.
+ * @param handle Pointer to the handle of the allocation.
+ */
+void heap_free_movable(heap_t* heap, heap_handle_t* handle) {
+    if (!heap || !handle || !handle->ptr) {
+        return;
+    }
+
+    heap_handle_t** link = &heap->movables;
+    while (*link && *link != handle) {
+        link = &(*link)->next;
+    }
+    if (!*link) {
+        return; // Not a movable allocation of this heap
+    }
+
+    *link = handle->next;
+    heap_free(heap, handle->ptr);
+    handle->ptr = NULL;
+    handle->next = NULL;
+}
+
+/**
+ * @brief Pin a movable allocation so that it stays in place until unpinned.
+ *        Pins nest, the allocation may move again once every pin is released.
+ * @param handle Pointer to the handle of the allocation.
+ * @return The current address of the allocation.
+ */
+void* heap_pin(heap_handle_t* handle) {
+    handle->pin_count++;
+    return handle->ptr;
+}
+
+/**
+ * @brief Release a pin taken with heap_pin. Pointers obtained from the pin must not be used afterwards.
+ * @param handle Pointer to the handle of the allocation.
+ */
+void heap_unpin(heap_handle_t* handle) {
+    if (handle->pin_count > 0) {
+        handle->pin_count--;
+    }
+}
+
+/**
+ * @brief Compact the movable allocations of a heap.
+ *        Walking them in address order, every unpinned allocation with a free run right
+ *        before it is moved to the start of that run. The run thereby ends up after the
+ *        allocation, where it merges with whatever free space follows.
+ *        Only the free list backend is supported, since buddy blocks cannot slide.
+ * @param heap Pointer to the heap structure.
+ * @return The number of blocks moved.
+ */
+uint32_t heap_compact(heap_t* heap) {
+    if (!heap || heap->backend != HEAP_BACKEND_FREE_LIST || !heap->movables) {
+        return 0;
+    }
+
+    heap_table_t* table = heap->table;
+    uint32_t moved_blocks = 0;
+    for (heap_handle_t* handle = heap->movables; handle; handle = handle->next) {
+        uint32_t start_block = heap_get_block_index(heap, handle->ptr);
+        if (handle->pin_count > 0 || start_block == 0 ||
+            HEAP_GET_ENTRY_TYPE(table->entries[start_block - 1]) != HEAP_BLOCK_TYPE_FREE) {
+            continue;
+        }
+
+        // Take the free run out of the index before the data overwrites its header
+        uint32_t gap_blocks = *heap_get_free_run_footer(heap, start_block - 1);
+        uint32_t new_start_block = start_block - gap_blocks;
+        uint32_t num_blocks = heap_get_allocation_num_blocks(table, start_block);
+        heap_free_list_remove(heap, new_start_block);
+
+        void* new_ptr = heap_get_block_address(heap, new_start_block);
+        memmove(new_ptr, handle->ptr, (size_t)num_blocks << heap->block_size_shift);
+        heap_table_set_used(table, new_start_block, num_blocks);
+        heap_release_blocks(heap, new_start_block + num_blocks, gap_blocks);
+
+        handle->ptr = new_ptr;
+        moved_blocks += num_blocks;
+    }
+
+    heap->stats.compactions++;
+    heap->stats.moved_blocks += moved_blocks;
+    return moved_blocks;
+}
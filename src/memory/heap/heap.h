@@ -3,18 +3,51 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include "status.h"
 #include "config.h"
 
 /**
  * The workflow of how the heap works is as follows:
- * 1. The heap is divided into fixed-size blocks (e.g., 4 KB).
+ * 1. The heap is divided into fixed-size blocks. The block size is a power of two chosen per heap
+ *    (e.g., 4 KB for a page heap, 64 B for a fine-grained heap of descriptors and strings).
  * 2. A heap block table is maintained to track the status of each block (free or used).
- * 3. When memory is allocated, the heap searches for a contiguous sequence of free blocks
- *    that can satisfy the requested size.
- * 4. The corresponding entries in the heap block table are updated to mark these blocks as used.
- * 5. When memory is freed, the corresponding blocks are marked as free in the heap block table.
+ * 3. Maximal runs of contiguous free blocks are indexed in segregated free lists, where
+ *    list n holds the runs whose length in blocks lies in [2^n, 2^(n+1)). The run header
+ *    lives in the first block of the run and its length is mirrored in the last block.
+ * 4. When memory is allocated, the smallest non-empty list whose runs are guaranteed to fit
+ *    is picked through a bitmap, the run is split and the remainder goes back to the index.
+ *    If all of those are empty, only the first HEAP_FREE_LIST_FALLBACK_RUNS runs of the
+ *    request's own list are tried, so a nearly full heap does not walk a long list.
+ * 5. The corresponding entries in the heap block table are updated to mark these blocks as used.
+ * 6. When memory is freed, the corresponding blocks are marked as free in the heap block table
+ *    and coalesced with the free runs right before and after them.
  * 
+ * Alternatively a heap can be initialized with the binary buddy backend. The same lists then
+ * hold free blocks of 2^n blocks which are naturally aligned (relative to the heap start).
+ * Requests are rounded up to a power of two, larger blocks are split in halves on allocation
+ * and freed blocks are merged with their buddy as long as it is free, both in O(log n).
+ * This keeps large contiguous runs available under mixed small and large allocations.
+ *
+ * A heap can be elastic. The block table then covers the largest size the heap may reach,
+ * but only the first active_blocks blocks are in use. The table tail beyond them is marked
+ * as reserved, so no allocation or coalescing ever touches it. When an allocation does not
+ * fit, the grow handler of the heap is called to bring more of the tail into use (heap_grow)
+ * and the allocation is retried. Free blocks at the end of the active range can be given
+ * back with heap_shrink.
+ *
+ * Caches built on a heap can register shrinkers. When an allocation fails even after growing,
+ * or when the headroom of the heap (free active blocks, plus the reserved blocks the grow handler
+ * could still bring into use, see heap_get_headroom) drops below the low watermark, the shrinkers are called in
+ * registration order until enough blocks are given back (up to the high watermark), and a failed
+ * allocation is retried. Caches can thus hold on to free memory without making allocations fail.
+ *
+ * Long-lived allocations can be made movable. They are reached through a caller-owned handle
+ * instead of a raw pointer, and the pointer is only stable while the handle is pinned. With the
+ * free list backend, heap_compact slides every unpinned movable allocation down over the free
+ * run right before it, so the free space scattered between them merges into larger runs.
+ * An allocation which still fails after reclaim compacts the heap and is retried once more.
+ *
  * The heap structure tracks a pointer to the heap block table instead of allocating memory directly,
  * allowing for flexibly managing different heap sizes and locations.
  * 
@@ -41,6 +74,21 @@
 #define HEAP_BLOCK_FLAG_HAS_NEXT_MASK (0x01 << 7)
 #define HEAP_BLOCK_FLAG_HAS_NEXT HEAP_BLOCK_FLAG_HAS_NEXT_MASK
 
+// Supported range of log2(block size). The lower bound leaves room for the free run header and footer.
+#define HEAP_MIN_BLOCK_SIZE_SHIFT 4
+#define HEAP_MAX_BLOCK_SIZE_SHIFT 22
+
+// Number of segregated free lists, one per power-of-two class of run lengths
+#define HEAP_FREE_LIST_COUNT 32
+// Runs of the request's own class looked at when no larger class has a run, keeps allocation O(1)
+#define HEAP_FREE_LIST_FALLBACK_RUNS 8
+
+// Allocation policy of a heap, chosen at heap_init time
+typedef enum {
+    HEAP_BACKEND_FREE_LIST = 0, // Segregated free lists of arbitrary-length runs
+    HEAP_BACKEND_BUDDY = 1      // Binary buddy allocator
+} heap_backend_t;
+
 // Type definition for heap implementation
 // used to represent the entry pointer in the heap block table
 typedef uint8_t heap_block_entry_t;
@@ -51,18 +99,111 @@ typedef struct heap_table {
     uint32_t total_blocks;
 } heap_table_t;
 
+// Usage counters of a heap. The free space fields are computed by heap_get_stats.
+typedef struct heap_stats {
+    uint32_t total_blocks;       // Blocks in use by the heap (active range)
+    uint32_t used_blocks;        // Blocks held by live allocations
+    uint32_t peak_used_blocks;   // Highest used_blocks so far
+    uint32_t free_blocks;        // Blocks not held by any allocation
+    uint32_t free_runs;          // Number of free runs (buddy blocks with the buddy backend)
+    uint32_t largest_free_run;   // Length of the largest free run in blocks
+    uint32_t fragmentation;      // Percentage of free blocks outside the largest free run
+    uint32_t allocations;        // Successful allocations
+    uint32_t frees;              // Successful frees
+    uint32_t failed_allocations; // Allocations which could not be satisfied
+    uint32_t reclaims;           // Times the shrinkers were called
+    uint32_t reclaimed_blocks;   // Blocks given back by the shrinkers
+    uint32_t compactions;        // Times the heap was compacted
+    uint32_t moved_blocks;       // Blocks of movable allocations moved by compaction
+} heap_stats_t;
+
+typedef struct heap heap_t; // Forward declaration
+
+/**
+ * @brief Called when an allocation does not fit in the active blocks of a heap.
+ *        The handler may bring more blocks into use through heap_grow.
+ * @param heap Pointer to the heap structure.
+ * @param num_blocks Number of contiguous blocks of the failed allocation.
+ * @return The number of blocks added to the heap, 0 if it cannot grow.
+ */
+typedef uint32_t (*heap_grow_handler_t)(heap_t* heap, uint32_t num_blocks);
+
+/**
+ * @brief Called to tell how many blocks the grow handler of a heap could still add,
+ *        e.g. when the memory behind the reserved tail is lent to someone else.
+ * @param heap Pointer to the heap structure.
+ * @return The number of blocks the grow handler could add right now.
+ */
+typedef uint32_t (*heap_growable_handler_t)(heap_t* heap);
+
+/**
+ * @brief Called under memory pressure to give free cached memory back to a heap.
+ *        The callback is not reentered. It may allocate from the heap as long as it
+ *        frees more than it takes (e.g. to store a compressed copy of what it frees).
+ * @param heap Pointer to the heap structure.
+ * @param num_blocks Number of blocks the heap would like to get back.
+ * @param data The data pointer of the shrinker.
+ * @return The number of blocks freed, which may be more or less than requested.
+ */
+typedef uint32_t (*heap_reclaim_func_t)(heap_t* heap, uint32_t num_blocks, void* data);
+
+// Reclaim callback of a cache, registered with heap_register_shrinker. Owned by the cache.
+typedef struct heap_shrinker {
+    heap_reclaim_func_t reclaim;
+    void* data;                 // Passed to the callback, e.g. the cache
+    struct heap_shrinker* next; // Next shrinker of the same heap
+} heap_shrinker_t;
+
+// Handle of a movable allocation, registered with heap_malloc_movable. Owned by the caller.
+typedef struct heap_handle {
+    void* ptr;                  // Current address of the allocation, only stable while pinned
+    uint32_t pin_count;         // The allocation is not moved while this is not 0
+    struct heap_handle* next;   // Next movable allocation of the same heap, by address
+} heap_handle_t;
+
 // Structure representing the heap
 typedef struct heap {
     heap_table_t* table;
     void* start_address;
+    heap_backend_t backend;
+    uint32_t block_size_shift; // log2 of the block size
+    uint32_t free_lists[HEAP_FREE_LIST_COUNT]; // First block index of each free list
+    uint32_t free_list_bitmap; // Bit n is set if free list n is not empty
+    uint32_t active_blocks; // Blocks in use by the heap, the rest of the table is reserved
+    heap_grow_handler_t grow_handler; // Optional, called when an allocation does not fit
+    heap_growable_handler_t growable_handler; // Optional, the whole reserved tail counts as growable without it
+    heap_shrinker_t* shrinkers; // Called under memory pressure, in registration order
+    uint32_t low_watermark; // Headroom in blocks below which the shrinkers are called
+    uint32_t high_watermark; // Headroom in blocks the shrinkers are asked to restore
+    bool reclaiming; // Set while the shrinkers run, to keep them from recursing
+    heap_handle_t* movables; // Movable allocations sorted by address
+    heap_stats_t stats; // Counters maintained on every allocation and free
 } heap_t;
 
 // Macros
 #define HEAP_GET_ENTRY_TYPE(entry) ((entry) & 0x0F)
+#define HEAP_GET_BLOCK_SIZE(heap) ((size_t)1 << (heap)->block_size_shift)
+#define HEAP_GET_BLOCK_MASK(heap) (HEAP_GET_BLOCK_SIZE(heap) - 1)
 
 // Heap management functions
-error_t heap_init(heap_t* heap, void* start_ptr, void* end_ptr, heap_table_t* table);
+error_t heap_init(heap_t* heap, void* start_ptr, void* end_ptr, heap_table_t* table, heap_backend_t backend, uint32_t block_size_shift);
 void* heap_malloc(heap_t* heap, size_t size);
 void heap_free(heap_t* heap, void* ptr);
+void* heap_realloc(heap_t* heap, void* ptr, size_t size);
+void* heap_get_allocation_start(heap_t* heap, void* ptr);
+uint32_t heap_grow(heap_t* heap, uint32_t num_blocks);
+uint32_t heap_shrink(heap_t* heap, uint32_t num_blocks);
+uint32_t heap_get_tail_free_blocks(heap_t* heap);
+uint32_t heap_get_headroom(heap_t* heap);
+void heap_get_stats(heap_t* heap, heap_stats_t* stats);
+void heap_register_shrinker(heap_t* heap, heap_shrinker_t* shrinker);
+void heap_unregister_shrinker(heap_t* heap, heap_shrinker_t* shrinker);
+void heap_set_watermarks(heap_t* heap, uint32_t low_blocks, uint32_t high_blocks);
+uint32_t heap_reclaim(heap_t* heap, uint32_t num_blocks);
+error_t heap_malloc_movable(heap_t* heap, heap_handle_t* handle, size_t size);
+void heap_free_movable(heap_t* heap, heap_handle_t* handle);
+void* heap_pin(heap_handle_t* handle);
+void heap_unpin(heap_handle_t* handle);
+uint32_t heap_compact(heap_t* heap);
 
 #endif // __HEAP_H__
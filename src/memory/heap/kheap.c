@@ -1,43 +1,301 @@
 #include "kheap.h"
 #include "heap.h"
+#include "slab.h"
 #include "utils/stdio.h"
 #include "memory/memory.h"
+#include "io/io.h"
+#include "memory/frame/frame.h"
 
 /**
  * @file kheap.c
  * @brief Kernel heap memory management implementation.
  */
 
+#define KERNEL_HEAP_SIZE_CLASS_COUNT (KERNEL_HEAP_SIZE_CLASS_MAX_SHIFT - KERNEL_HEAP_SIZE_CLASS_MIN_SHIFT + 1)
+#define KERNEL_HEAP_INITIAL_BLOCKS (KERNEL_HEAP_INITIAL_SIZE_BYTES >> KERNEL_HEAP_BLOCK_SIZE_SHIFT)
+#define KERNEL_HEAP_GROW_BLOCKS (KERNEL_HEAP_GROW_SIZE_BYTES >> KERNEL_HEAP_BLOCK_SIZE_SHIFT)
+#define KERNEL_HEAP_SHRINK_THRESHOLD_BLOCKS (KERNEL_HEAP_SHRINK_THRESHOLD_BYTES >> KERNEL_HEAP_BLOCK_SIZE_SHIFT)
+#define KERNEL_HEAP_LOW_WATERMARK_BLOCKS (KERNEL_HEAP_LOW_WATERMARK_BYTES >> KERNEL_HEAP_BLOCK_SIZE_SHIFT)
+#define KERNEL_HEAP_HIGH_WATERMARK_BLOCKS (KERNEL_HEAP_HIGH_WATERMARK_BYTES >> KERNEL_HEAP_BLOCK_SIZE_SHIFT)
+
+// CMOS registers holding the memory size detected by the BIOS
+#define CMOS_ADDRESS_PORT 0x70
+#define CMOS_DATA_PORT 0x71
+#define CMOS_EXTENDED_MEMORY_LOW 0x30  // Memory above 1 MB in KB, up to 64 MB
+#define CMOS_EXTENDED_MEMORY_HIGH 0x31
+#define CMOS_HIGH_MEMORY_LOW 0x34      // Memory above 16 MB in 64 KB units
+#define CMOS_HIGH_MEMORY_HIGH 0x35
+
 static heap_t kernel_heap;
 static heap_table_t kernel_heap_table;
+static kmem_cache_t* kernel_heap_caches = NULL; // All caches backed by the kernel heap, for diagnostics
+static heap_shrinker_t kernel_heap_shrinker; // Gives the memory cached by kheap itself back under pressure
+
+// kmalloc-style caches for small requests, one per power-of-two size class
+static kmem_cache_t kernel_heap_size_caches[KERNEL_HEAP_SIZE_CLASS_COUNT];
+static const char* kernel_heap_size_cache_names[] = {
+    "kmalloc-16", "kmalloc-32", "kmalloc-64", "kmalloc-128",
+    "kmalloc-256", "kmalloc-512", "kmalloc-1024", "kmalloc-2048"
+};
+_Static_assert(sizeof(kernel_heap_size_cache_names) / sizeof(kernel_heap_size_cache_names[0]) == KERNEL_HEAP_SIZE_CLASS_COUNT,
+               "A name is required for every kernel heap size class");
+
+#if KERNEL_HEAP_PROFILING
+// Allocation counters of one caller of the kheap allocation functions
+typedef struct kheap_call_site {
+    void* caller;                // Return address into the calling function
+    uint32_t allocations;        // Successful allocations made from there
+    uint32_t failed_allocations; // Allocations which returned NULL
+    size_t bytes;                // Bytes requested by the successful allocations
+} kheap_call_site_t;
+
+static kheap_call_site_t kernel_heap_call_sites[KERNEL_HEAP_PROFILE_MAX_CALL_SITES];
+static uint32_t kernel_heap_untracked_allocations = 0; // Allocations from callers which did not fit in the table
+
+/**
+ * @brief Count an allocation in the histogram of its call site (open addressing on the caller address).
+ * @param caller Return address of the kheap allocation function.
+ * @param size The requested size in bytes.
+ * @param ptr The result of the allocation.
+ */
+static void kheap_profile_allocation(void* caller, size_t size, void* ptr) {
+    uint32_t index = ((uintptr_t)caller >> 2) % KERNEL_HEAP_PROFILE_MAX_CALL_SITES;
+    for (uint32_t i = 0; i < KERNEL_HEAP_PROFILE_MAX_CALL_SITES; i++) {
+        kheap_call_site_t* site = &kernel_heap_call_sites[(index + i) % KERNEL_HEAP_PROFILE_MAX_CALL_SITES];
+        if (!site->caller) {
+            site->caller = caller;
+        }
+        if (site->caller == caller) {
+            if (ptr) {
+                site->allocations++;
+                site->bytes += size;
+            } else {
+                site->failed_allocations++;
+            }
+            return;
+        }
+    }
+    kernel_heap_untracked_allocations++;
+}
+
+// Must be expanded in the public allocation functions, so that the caller is the kheap user
+#define KHEAP_PROFILE_ALLOCATION(size, ptr) kheap_profile_allocation(__builtin_return_address(0), (size), (ptr))
+#else
+#define KHEAP_PROFILE_ALLOCATION(size, ptr)
+#endif
+
+/**
+ * @brief Get the size class cache serving a request.
+ * @param size The size of memory to allocate in bytes.
+ * @return Pointer to the cache, or NULL if the request is too large (or empty) for the size classes.
+ */
+static kmem_cache_t* kheap_get_size_cache(size_t size) {
+    if (size == 0 || size > (1U << KERNEL_HEAP_SIZE_CLASS_MAX_SHIFT)) {
+        return NULL;
+    }
+
+    uint32_t shift = KERNEL_HEAP_SIZE_CLASS_MIN_SHIFT;
+    if (size > (1U << KERNEL_HEAP_SIZE_CLASS_MIN_SHIFT)) {
+        shift = 32 - (uint32_t)__builtin_clz((uint32_t)size - 1); // ceil(log2(size))
+    }
+    return &kernel_heap_size_caches[shift - KERNEL_HEAP_SIZE_CLASS_MIN_SHIFT];
+}
+
+/**
+ * @brief Read a CMOS register.
+ * @param reg The register index.
+ * @return The register value.
+ */
+static uint8_t kheap_read_cmos(uint8_t reg) {
+    io_outb(CMOS_ADDRESS_PORT, reg);
+    return io_inb(CMOS_DATA_PORT);
+}
+
+/**
+ * @brief Detect the end of the RAM from the memory size the BIOS stores in the CMOS.
+ * @return The end address of the RAM, capped at the end of the largest possible kernel heap.
+ */
+uintptr_t kheap_get_memory_end() {
+    uintptr_t heap_limit = (uintptr_t)KERNEL_HEAP_ADDRESS + KERNEL_HEAP_MAX_SIZE_BYTES;
+
+    uint32_t high_memory_units = kheap_read_cmos(CMOS_HIGH_MEMORY_LOW) |
+                                 ((uint32_t)kheap_read_cmos(CMOS_HIGH_MEMORY_HIGH) << 8);
+    if (high_memory_units > 0) {
+        if (high_memory_units > ((heap_limit - 0x01000000) >> 16)) {
+            return heap_limit;
+        }
+        return 0x01000000 + (high_memory_units << 16);
+    }
+
+    // Machines with less than 16 MB only report the extended memory
+    uint32_t extended_memory_kb = kheap_read_cmos(CMOS_EXTENDED_MEMORY_LOW) |
+                                  ((uint32_t)kheap_read_cmos(CMOS_EXTENDED_MEMORY_HIGH) << 8);
+    return 0x00100000 + (extended_memory_kb << 10);
+}
+
+/**
+ * @brief Get the end of the blocks in use by the kernel heap. The frame region starts there.
+ * @return The end address of the kernel heap (exclusive), the end of the RAM if the heap failed to initialize.
+ */
+uintptr_t kheap_get_end() {
+    if (!kernel_heap.start_address) {
+        return kheap_get_memory_end(); // Not initialized, nothing to lend
+    }
+    return (uintptr_t)kernel_heap.start_address + (kernel_heap.active_blocks << KERNEL_HEAP_BLOCK_SIZE_SHIFT);
+}
+
+/**
+ * @brief Grow the kernel heap when an allocation does not fit.
+ *        The kernel paging chunk identity maps the whole RAM, so growing only has to take
+ *        untouched frames back from the bottom of the frame region and bring as many blocks
+ *        of the reserved table tail into use.
+ * @param heap Pointer to the kernel heap.
+ * @param num_blocks Number of contiguous blocks of the failed allocation.
+ * @return The number of blocks added.
+ */
+static uint32_t kheap_grow(heap_t* heap, uint32_t num_blocks) {
+    uint32_t grow_blocks = num_blocks;
+    if (heap->backend == HEAP_BACKEND_BUDDY && num_blocks > 1) {
+        // Twice the rounded up size always holds a naturally aligned buddy block of that size
+        grow_blocks = 2U << (32 - (uint32_t)__builtin_clz(num_blocks - 1));
+    }
+    if (grow_blocks < KERNEL_HEAP_GROW_BLOCKS) {
+        grow_blocks = KERNEL_HEAP_GROW_BLOCKS;
+    }
+    uint32_t reserved_blocks = heap->table->total_blocks - heap->active_blocks;
+    if (grow_blocks > reserved_blocks) {
+        grow_blocks = reserved_blocks;
+    }
+
+    uintptr_t heap_end = kheap_get_end();
+    uintptr_t granted_end = frame_shrink_region(heap_end + (grow_blocks << KERNEL_HEAP_BLOCK_SIZE_SHIFT));
+    return heap_grow(heap, (granted_end - heap_end) >> KERNEL_HEAP_BLOCK_SIZE_SHIFT);
+}
+
+/**
+ * @brief Tell how many blocks kheap_grow could add, i.e. the untouched frames it could take back.
+ *        Frames handed out by the frame allocator cannot be taken back, so the reserved table tail
+ *        behind them does not count as headroom.
+ * @param heap Pointer to the kernel heap.
+ * @return The number of blocks the heap could grow by.
+ */
+static uint32_t kheap_get_growable_blocks(heap_t* heap) {
+    return (frame_get_untouched_frames() * PAGE_SIZE) >> KERNEL_HEAP_BLOCK_SIZE_SHIFT;
+}
+
+/**
+ * @brief Shrink the kernel heap when too much free memory has piled up at its end, and hand
+ *        the released blocks to the frame allocator.
+ *        One growth step stays free to avoid bouncing between growing and shrinking.
+ */
+static void kheap_trim() {
+    uint32_t tail_blocks = heap_get_tail_free_blocks(&kernel_heap);
+    if (tail_blocks < KERNEL_HEAP_SHRINK_THRESHOLD_BLOCKS) {
+        return;
+    }
+
+    uint32_t release_blocks = tail_blocks - KERNEL_HEAP_GROW_BLOCKS;
+    if (kernel_heap.active_blocks - release_blocks < KERNEL_HEAP_INITIAL_BLOCKS) {
+        release_blocks = kernel_heap.active_blocks > KERNEL_HEAP_INITIAL_BLOCKS
+            ? kernel_heap.active_blocks - KERNEL_HEAP_INITIAL_BLOCKS
+            : 0;
+    }
+    if (heap_shrink(&kernel_heap, release_blocks) > 0) {
+        frame_extend_region(kheap_get_end());
+    }
+}
+
+/**
+ * @brief Reclaim callback of the kernel heap's own caches, which gives back the empty slabs of the object caches.
+ * @param heap Pointer to the kernel heap.
+ * @param num_blocks Number of blocks the heap would like to get back.
+ * @param data Unused.
+ * @return The number of blocks freed.
+ */
+static uint32_t kheap_reclaim(heap_t* heap, uint32_t num_blocks, void* data) {
+    uint32_t freed_blocks = 0;
+    for (kmem_cache_t* cache = kernel_heap_caches; cache && freed_blocks < num_blocks; cache = cache->next) {
+        freed_blocks += kmem_cache_shrink(cache);
+    }
+    return freed_blocks;
+}
 
 /**
  * @brief Initialize the kernel heap.
+ *        The block table covers the RAM above KERNEL_HEAP_ADDRESS up to the share kept by the frame
+ *        allocator, but only KERNEL_HEAP_INITIAL_SIZE_BYTES are in use at first. The rest is lent to
+ *        the frame allocator (see kheap_get_end). The heap grows into untouched frames when an allocation
+ *        does not fit and gives its end back to the frame allocator when it becomes free.
  */
 void kheap_init() {
-    void* heap_start = (void*)KERNEL_HEAP_ADDRESS;
-    void* heap_end = (void*)((uintptr_t)KERNEL_HEAP_ADDRESS + KERNEL_HEAP_SIZE_BYTES);
+    uintptr_t heap_start = KERNEL_HEAP_ADDRESS;
+    uintptr_t heap_end = frame_get_region_start(kheap_get_memory_end()) & ~(uintptr_t)(KERNEL_HEAP_BLOCK_SIZE - 1);
+    if (heap_end < heap_start + KERNEL_HEAP_INITIAL_SIZE_BYTES) {
+        printf("Not enough memory for the kernel heap: RAM ends at %x\n", heap_end);
+        return;
+    }
     void* table_address = (void*)KERNEL_HEAP_TABLE_ADDRESS;
 
     // Initialize the kernel heap block table
     kernel_heap_table.entries = (heap_block_entry_t*)table_address;
-    kernel_heap_table.total_blocks = KERNEL_HEAP_MAX_BLOCKS;
+    kernel_heap_table.total_blocks = (heap_end - heap_start) >> KERNEL_HEAP_BLOCK_SIZE_SHIFT;
 
     // Initialize the kernel heap
-    error_t err = heap_init(&kernel_heap, heap_start, heap_end, &kernel_heap_table);
+    error_t err = heap_init(&kernel_heap, (void*)heap_start, (void*)heap_end, &kernel_heap_table, KERNEL_HEAP_BACKEND, KERNEL_HEAP_BLOCK_SIZE_SHIFT);
     if (err != ENONE) {
         // Handle initialization error (e.g., log it)
         printf("Kernel heap initialization failed with error code: %d\n", err);
+        return;
     }
+
+    // Start small and reserve the rest of the table for growth
+    heap_shrink(&kernel_heap, kernel_heap_table.total_blocks - KERNEL_HEAP_INITIAL_BLOCKS);
+    kernel_heap.grow_handler = kheap_grow;
+    kernel_heap.growable_handler = kheap_get_growable_blocks;
+
+    // Let the caches give memory back before the heap runs dry
+    heap_set_watermarks(&kernel_heap, KERNEL_HEAP_LOW_WATERMARK_BLOCKS, KERNEL_HEAP_HIGH_WATERMARK_BLOCKS);
+    kernel_heap_shrinker.reclaim = kheap_reclaim;
+    kernel_heap_shrinker.data = NULL;
+    heap_register_shrinker(&kernel_heap, &kernel_heap_shrinker);
+
+    // Initialize the size class caches
+    for (uint32_t i = 0; i < KERNEL_HEAP_SIZE_CLASS_COUNT; i++) {
+        size_t object_size = 1U << (KERNEL_HEAP_SIZE_CLASS_MIN_SHIFT + i);
+        err = kmem_cache_init(&kernel_heap_size_caches[i], &kernel_heap, kernel_heap_size_cache_names[i], object_size, NULL);
+        if (err != ENONE) {
+            printf("Kernel heap size class %s initialization failed with error code: %d\n", kernel_heap_size_cache_names[i], err);
+            continue;
+        }
+        kernel_heap_size_caches[i].next = kernel_heap_caches;
+        kernel_heap_caches = &kernel_heap_size_caches[i];
+    }
+}
+
+/**
+ * @brief Allocate memory from the size class caches or the heap.
+ * @param size The size of memory to allocate in bytes.
+ * @return Pointer to the allocated memory, or NULL if allocation fails.
+ */
+static void* kheap_allocate(size_t size) {
+    kmem_cache_t* cache = kheap_get_size_cache(size);
+    if (cache) {
+        return kmem_cache_alloc(cache);
+    }
+    return heap_malloc(&kernel_heap, size);
 }
 
 /**
  * @brief Allocate memory from the kernel heap.
+ *        Small requests are served by the size class caches and are only aligned to
+ *        KMEM_OBJECT_ALIGNMENT. Use kheap_malloc_pages when page alignment is required.
  * @param size The size of memory to allocate in bytes.
  * @return Pointer to the allocated memory, or NULL if allocation fails.
  */
 void* kheap_malloc(size_t size) {
-    return heap_malloc(&kernel_heap, size);
+    void* ptr = kheap_allocate(size);
+    KHEAP_PROFILE_ALLOCATION(size, ptr);
+    return ptr;
 }
 
 /**
@@ -46,17 +304,247 @@ void* kheap_malloc(size_t size) {
  * @return Pointer to the allocated memory, or NULL if allocation fails.
  */
 void* kheap_zmalloc(size_t size) {
-    void* ptr = kheap_malloc(size);
+    void* ptr = kheap_allocate(size);
     if (ptr) {
         memset(ptr, 0, size);
     }
+    KHEAP_PROFILE_ALLOCATION(size, ptr);
+    return ptr;
+}
+
+/**
+ * @brief Allocate page-aligned memory from the kernel heap, bypassing the size class caches.
+ *        Page tables, process images and anything else mapped through paging must use this.
+ * @param size The size of memory to allocate in bytes.
+ * @return Pointer to the allocated memory, or NULL if allocation fails.
+ */
+void* kheap_malloc_pages(size_t size) {
+    void* ptr = heap_malloc(&kernel_heap, size);
+    KHEAP_PROFILE_ALLOCATION(size, ptr);
+    return ptr;
+}
+
+/**
+ * @brief Allocate zero-initialized page-aligned memory from the kernel heap.
+ * @param size The size of memory to allocate in bytes.
+ * @return Pointer to the allocated memory, or NULL if allocation fails.
+ */
+void* kheap_zmalloc_pages(size_t size) {
+    void* ptr = heap_malloc(&kernel_heap, size);
+    if (ptr) {
+        memset(ptr, 0, size);
+    }
+    KHEAP_PROFILE_ALLOCATION(size, ptr);
     return ptr;
 }
 
 /**
  * @brief Free memory back to the kernel heap.
+ *        Works for any pointer returned by the kheap and kmem_cache allocation functions.
  * @param ptr Pointer to the memory to free.
  */
 void kheap_free(void* ptr) {
-    heap_free(&kernel_heap, ptr);
+    if (!ptr) {
+        return;
+    }
+
+    // Slab objects never sit at the start of a heap allocation, page allocations always do
+    kmem_cache_t* cache = kmem_cache_get_by_object(&kernel_heap, ptr);
+    if (cache) {
+        kmem_cache_free(cache, ptr);
+    } else {
+        heap_free(&kernel_heap, ptr);
+    }
+
+    kheap_trim();
+}
+
+/**
+ * @brief Resize memory of the kernel heap.
+ *        Heap allocations are resized in place when the neighbouring blocks allow (see heap_realloc).
+ *        Slab objects stay put as long as the new size fits in their size class.
+ * @param ptr Pointer to the memory to resize, or NULL to allocate.
+ * @param size The new size in bytes, or 0 to free.
+ * @return Pointer to the resized memory, or NULL if it fails (the old memory is left untouched).
+ */
+void* kheap_realloc(void* ptr, size_t size) {
+    void* new_ptr = NULL;
+    if (!ptr) {
+        new_ptr = kheap_allocate(size);
+        goto exit;
+    }
+    if (size == 0) {
+        kheap_free(ptr);
+        return NULL;
+    }
+
+    kmem_cache_t* cache = kmem_cache_get_by_object(&kernel_heap, ptr);
+    if (!cache) {
+        new_ptr = heap_realloc(&kernel_heap, ptr, size);
+        kheap_trim();
+        goto exit;
+    }
+
+    if (size <= cache->object_size) {
+        new_ptr = ptr;
+        goto exit;
+    }
+
+    new_ptr = kheap_allocate(size);
+    if (new_ptr) {
+        memcpy(new_ptr, ptr, cache->object_size);
+        kmem_cache_free(cache, ptr);
+    }
+
+exit:
+    KHEAP_PROFILE_ALLOCATION(size, new_ptr);
+    return new_ptr;
+}
+
+/**
+ * @brief Create an object cache whose slabs come from the kernel heap.
+ * @param name Name of the cache, for diagnostics.
+ * @param object_size Size of each object in bytes.
+ * @param ctor Optional constructor called on every allocated object, or NULL.
+ * @return Pointer to the new cache, or NULL on failure.
+ */
+kmem_cache_t* kmem_cache_create(const char* name, size_t object_size, kmem_cache_ctor_t ctor) {
+    kmem_cache_t* cache = (kmem_cache_t*)kheap_malloc(sizeof(kmem_cache_t));
+    if (!cache) {
+        return NULL;
+    }
+
+    if (kmem_cache_init(cache, &kernel_heap, name, object_size, ctor) != ENONE) {
+        kheap_free(cache);
+        return NULL;
+    }
+
+    cache->next = kernel_heap_caches;
+    kernel_heap_caches = cache;
+    return cache;
+}
+
+/**
+ * @brief Register a shrinker for a cache backed by the kernel heap.
+ *        It is called when an allocation fails or the heap drops below its low watermark.
+ * @param shrinker Pointer to the shrinker, owned by the caller.
+ */
+void kheap_register_shrinker(heap_shrinker_t* shrinker) {
+    heap_register_shrinker(&kernel_heap, shrinker);
+}
+
+/**
+ * @brief Unregister a shrinker of the kernel heap.
+ * @param shrinker Pointer to the shrinker.
+ */
+void kheap_unregister_shrinker(heap_shrinker_t* shrinker) {
+    heap_unregister_shrinker(&kernel_heap, shrinker);
+}
+
+/**
+ * @brief Allocate movable memory from the kernel heap, for long-lived buffers which are
+ *        only accessed now and then. Access it through kheap_pin and kheap_unpin.
+ *        The memory is made of whole heap blocks, it never comes from the size class caches.
+ * @param size The size of memory to allocate in bytes.
+ * @return Pointer to the handle of the allocation, or NULL if allocation fails.
+ */
+heap_handle_t* kheap_malloc_movable(size_t size) {
+    heap_handle_t* handle = (heap_handle_t*)kheap_malloc(sizeof(heap_handle_t));
+    if (!handle) {
+        return NULL;
+    }
+
+    if (heap_malloc_movable(&kernel_heap, handle, size) != ENONE) {
+        kheap_free(handle);
+        return NULL;
+    }
+    return handle;
+}
+
+/**
+ * @brief Free movable memory of the kernel heap together with its handle.
+ * @param handle Pointer to the handle returned by kheap_malloc_movable.
+ */
+void kheap_free_movable(heap_handle_t* handle) {
+    if (!handle) {
+        return;
+    }
+
+    heap_free_movable(&kernel_heap, handle);
+    kheap_free(handle);
+}
+
+/**
+ * @brief Pin movable memory of the kernel heap, so that compaction leaves it in place until unpinned.
+ * @param handle Pointer to the handle returned by kheap_malloc_movable.
+ * @return The current address of the memory.
+ */
+void* kheap_pin(heap_handle_t* handle) {
+    return heap_pin(handle);
+}
+
+/**
+ * @brief Release a pin taken with kheap_pin. Pointers obtained from the pin must not be used afterwards.
+ * @param handle Pointer to the handle returned by kheap_malloc_movable.
+ */
+void kheap_unpin(heap_handle_t* handle) {
+    heap_unpin(handle);
+}
+
+/**
+ * @brief Compact the movable allocations of the kernel heap and give the free tail back.
+ * @return The number of blocks moved.
+ */
+uint32_t kheap_compact() {
+    uint32_t moved_blocks = heap_compact(&kernel_heap);
+    kheap_trim();
+    return moved_blocks;
+}
+
+/**
+ * @brief Get the usage counters and free space metrics of the kernel heap.
+ * @param stats Pointer to store the statistics.
+ */
+void kheap_get_stats(heap_stats_t* stats) {
+    heap_get_stats(&kernel_heap, stats);
+}
+
+/**
+ * @brief Print the kernel heap statistics, the object caches and,
+ *        with KERNEL_HEAP_PROFILING, the allocations per call site.
+ */
+void kheap_dump_stats() {
+    heap_stats_t stats;
+    kheap_get_stats(&stats);
+
+    printf("Kernel heap: %u of %u blocks used (peak %u), %u KB per block\n",
+           stats.used_blocks, stats.total_blocks, stats.peak_used_blocks, KERNEL_HEAP_BLOCK_SIZE / 1024);
+    printf("  free: %u blocks in %u runs, largest run %u, fragmentation %u percent\n",
+           stats.free_blocks, stats.free_runs, stats.largest_free_run, stats.fragmentation);
+    printf("  allocations: %u, frees: %u, failed: %u\n",
+           stats.allocations, stats.frees, stats.failed_allocations);
+    printf("  reclaims: %u, reclaimed blocks: %u\n", stats.reclaims, stats.reclaimed_blocks);
+    printf("  compactions: %u, moved blocks: %u\n", stats.compactions, stats.moved_blocks);
+
+    for (kmem_cache_t* cache = kernel_heap_caches; cache; cache = cache->next) {
+        if (cache->num_slabs == 0) {
+            continue;
+        }
+        printf("  cache %s: %u objects of %u bytes in use, %u slabs\n",
+               cache->name, cache->objects_in_use, cache->object_size, cache->num_slabs);
+    }
+
+#if KERNEL_HEAP_PROFILING
+    for (uint32_t i = 0; i < KERNEL_HEAP_PROFILE_MAX_CALL_SITES; i++) {
+        kheap_call_site_t* site = &kernel_heap_call_sites[i];
+        if (!site->caller) {
+            continue;
+        }
+        printf("  call site %p: %u allocations, %u bytes, %u failed\n",
+               site->caller, site->allocations, site->bytes, site->failed_allocations);
+    }
+    if (kernel_heap_untracked_allocations > 0) {
+        printf("  untracked call sites: %u allocations\n", kernel_heap_untracked_allocations);
+    }
+#endif
 }
\ No newline at end of file
@@ -3,11 +3,30 @@
 
 #include <stddef.h>
 #include "config.h"
+#include "heap.h"
+#include "slab.h"
 
 // Kernel heap management functions
 void kheap_init();
+uintptr_t kheap_get_memory_end();
+uintptr_t kheap_get_end();
 void* kheap_malloc(size_t size);
 void* kheap_zmalloc(size_t size);
+void* kheap_malloc_pages(size_t size);
+void* kheap_zmalloc_pages(size_t size);
 void kheap_free(void* ptr);
+void* kheap_realloc(void* ptr, size_t size);
+void kheap_get_stats(heap_stats_t* stats);
+void kheap_dump_stats();
+void kheap_register_shrinker(heap_shrinker_t* shrinker);
+void kheap_unregister_shrinker(heap_shrinker_t* shrinker);
+heap_handle_t* kheap_malloc_movable(size_t size);
+void kheap_free_movable(heap_handle_t* handle);
+void* kheap_pin(heap_handle_t* handle);
+void kheap_unpin(heap_handle_t* handle);
+uint32_t kheap_compact();
+
+// Object caches backed by the kernel heap
+kmem_cache_t* kmem_cache_create(const char* name, size_t object_size, kmem_cache_ctor_t ctor);
 
 #endif // __KHEAP_H__
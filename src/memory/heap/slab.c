@@ -0,0 +1,275 @@
+#include "slab.h"
+#include "memory/memory.h"
+#include "utils/string.h"
+#include "utils/stdio.h"
+
+/**
+ * @file slab.c
+ * @brief Slab (object cache) allocator built on top of the general heap.
+ */
+
+/**
+ * @brief Get the offset of the first object in a slab, i.e. the aligned size of the slab header.
+ * @return The offset in bytes.
+ */
+static inline size_t kmem_slab_get_objects_offset() {
+    return (sizeof(kmem_slab_t) + KMEM_OBJECT_ALIGNMENT - 1) & ~(size_t)(KMEM_OBJECT_ALIGNMENT - 1);
+}
+
+/**
+ * @brief Get the address of the first object in a slab.
+ * @param slab Pointer to the slab.
+ * @return The address of the first object.
+ */
+static inline uintptr_t kmem_slab_get_objects_start(kmem_slab_t* slab) {
+    return (uintptr_t)slab + kmem_slab_get_objects_offset();
+}
+
+/**
+ * @brief Push a slab to the front of a slab list.
+ * @param list Pointer to the list head.
+ * @param slab Pointer to the slab.
+ */
+static void kmem_slab_list_push(kmem_slab_t** list, kmem_slab_t* slab) {
+    slab->prev = NULL;
+    slab->next = *list;
+    if (*list) {
+        (*list)->prev = slab;
+    }
+    *list = slab;
+}
+
+/**
+ * @brief Unlink a slab from a slab list.
+ * @param list Pointer to the list head.
+ * @param slab Pointer to the slab.
+ */
+static void kmem_slab_list_remove(kmem_slab_t** list, kmem_slab_t* slab) {
+    if (slab->prev) {
+        slab->prev->next = slab->next;
+    } else {
+        *list = slab->next;
+    }
+    if (slab->next) {
+        slab->next->prev = slab->prev;
+    }
+    slab->next = NULL;
+    slab->prev = NULL;
+}
+
+/**
+ * @brief Get the list a slab belongs to according to its number of objects in use.
+ * @param cache Pointer to the owning cache.
+ * @param slab Pointer to the slab.
+ * @return Pointer to the list head.
+ */
+static kmem_slab_t** kmem_cache_get_slab_list(kmem_cache_t* cache, kmem_slab_t* slab) {
+    if (slab->in_use == 0) {
+        return &cache->slabs_empty;
+    }
+    if (slab->in_use == cache->objects_per_slab) {
+        return &cache->slabs_full;
+    }
+    return &cache->slabs_partial;
+}
+
+/**
+ * @brief Allocate a new slab from the heap and put it on the empty list.
+ * @param cache Pointer to the owning cache.
+ * @return Pointer to the new slab, or NULL if the heap is exhausted.
+ */
+static kmem_slab_t* kmem_slab_create(kmem_cache_t* cache) {
+    kmem_slab_t* slab = (kmem_slab_t*)heap_malloc(cache->heap, cache->slab_blocks * HEAP_GET_BLOCK_SIZE(cache->heap));
+    if (!slab) {
+        return NULL;
+    }
+
+    slab->magic = KMEM_SLAB_MAGIC;
+    slab->cache = cache;
+    slab->in_use = 0;
+    slab->free_objects = NULL;
+
+    // Chain the objects in address order, so the first allocations are adjacent
+    uintptr_t objects_start = kmem_slab_get_objects_start(slab);
+    for (uint32_t i = cache->objects_per_slab; i > 0; i--) {
+        void** object = (void**)(objects_start + (i - 1) * cache->object_size);
+        *object = slab->free_objects;
+        slab->free_objects = object;
+    }
+
+    kmem_slab_list_push(&cache->slabs_empty, slab);
+    cache->num_slabs++;
+    return slab;
+}
+
+/**
+ * @brief Find the slab an object was carved from.
+ * @param heap Pointer to the heap the slab lives in.
+ * @param object Pointer to the object.
+ * @return Pointer to the slab, or NULL if the pointer is not a slab object.
+ */
+static kmem_slab_t* kmem_slab_get_by_object(heap_t* heap, void* object) {
+    kmem_slab_t* slab = (kmem_slab_t*)heap_get_allocation_start(heap, object);
+    if (!slab || (void*)slab == object || slab->magic != KMEM_SLAB_MAGIC) {
+        return NULL;
+    }
+
+    // The pointer must be the start of one of the objects
+    uintptr_t objects_start = kmem_slab_get_objects_start(slab);
+    uintptr_t offset = (uintptr_t)object - objects_start;
+    if ((uintptr_t)object < objects_start ||
+        offset % slab->cache->object_size != 0 ||
+        offset / slab->cache->object_size >= slab->cache->objects_per_slab) {
+        return NULL;
+    }
+
+    return slab;
+}
+
+/**
+ * @brief Initialize an object cache.
+ *        The slab size is the smallest power-of-two number of heap blocks
+ *        which wastes at most 1/8 of the slab, capped at KMEM_SLAB_MAX_BLOCKS.
+ * @param cache Pointer to the cache structure to initialize.
+ * @param heap Pointer to the heap the slabs are allocated from.
+ * @param name Name of the cache, for diagnostics.
+ * @param object_size Size of each object in bytes.
+ * @param ctor Optional constructor called on every allocated object, or NULL.
+ * @return ENONE if successful, error code otherwise (< 0).
+ */
+error_t kmem_cache_init(kmem_cache_t* cache, heap_t* heap, const char* name, size_t object_size, kmem_cache_ctor_t ctor) {
+    if (!cache || !heap || !name || object_size == 0) {
+        return -EINVAL;
+    }
+
+    memset(cache, 0, sizeof(kmem_cache_t));
+    strncpy(cache->name, name, KMEM_CACHE_NAME_LENGTH - 1);
+    cache->heap = heap;
+    cache->ctor = ctor;
+
+    // Every free object has to hold the free list link
+    if (object_size < sizeof(void*)) {
+        object_size = sizeof(void*);
+    }
+    cache->object_size = (object_size + KMEM_OBJECT_ALIGNMENT - 1) & ~(size_t)(KMEM_OBJECT_ALIGNMENT - 1);
+
+    for (uint32_t blocks = 1; blocks <= KMEM_SLAB_MAX_BLOCKS; blocks <<= 1) {
+        size_t slab_size = blocks * HEAP_GET_BLOCK_SIZE(heap);
+        size_t usable_size = slab_size - kmem_slab_get_objects_offset();
+        if (usable_size < cache->object_size) {
+            continue;
+        }
+
+        cache->slab_blocks = blocks;
+        cache->objects_per_slab = usable_size / cache->object_size;
+        size_t wasted_size = slab_size - cache->objects_per_slab * cache->object_size;
+        if (wasted_size * 8 <= slab_size) {
+            break;
+        }
+    }
+
+    if (cache->objects_per_slab == 0) {
+        return -EINVAL; // Object does not fit in the largest slab
+    }
+
+    return ENONE;
+}
+
+/**
+ * @brief Allocate an object from a cache.
+ * @param cache Pointer to the cache.
+ * @return Pointer to the object, or NULL if allocation fails.
+ */
+void* kmem_cache_alloc(kmem_cache_t* cache) {
+    if (!cache) {
+        return NULL;
+    }
+
+    // Prefer partially used slabs to keep the number of slabs low
+    kmem_slab_t* slab = cache->slabs_partial;
+    if (!slab) {
+        slab = cache->slabs_empty;
+    }
+    if (!slab) {
+        slab = kmem_slab_create(cache);
+        if (!slab) {
+            return NULL;
+        }
+    }
+
+    kmem_slab_list_remove(kmem_cache_get_slab_list(cache, slab), slab);
+    void** object = (void**)slab->free_objects;
+    slab->free_objects = *object;
+    slab->in_use++;
+    cache->objects_in_use++;
+    kmem_slab_list_push(kmem_cache_get_slab_list(cache, slab), slab);
+
+    if (cache->ctor) {
+        cache->ctor(object);
+    }
+    return object;
+}
+
+/**
+ * @brief Return an object to its cache.
+ * @param cache Pointer to the cache.
+ * @param object Pointer to the object to free.
+ */
+void kmem_cache_free(kmem_cache_t* cache, void* object) {
+    if (!cache || !object) {
+        return;
+    }
+
+    kmem_slab_t* slab = kmem_slab_get_by_object(cache->heap, object);
+    if (!slab || slab->cache != cache) {
+        printf("Object %p does not belong to cache %s\n", object, cache->name);
+        return;
+    }
+
+    kmem_slab_list_remove(kmem_cache_get_slab_list(cache, slab), slab);
+    *(void**)object = slab->free_objects;
+    slab->free_objects = object;
+    slab->in_use--;
+    cache->objects_in_use--;
+
+    // Keep a single empty slab to absorb alloc/free ping-pong, release the others
+    if (slab->in_use == 0 && cache->slabs_empty) {
+        heap_free(cache->heap, slab);
+        cache->num_slabs--;
+        return;
+    }
+    kmem_slab_list_push(kmem_cache_get_slab_list(cache, slab), slab);
+}
+
+/**
+ * @brief Find the cache an object was allocated from.
+ * @param heap Pointer to the heap the object lives in.
+ * @param object Pointer to the object.
+ * @return Pointer to the owning cache, or NULL if the pointer is not a slab object
+ *         (e.g. it is the start of a plain heap allocation).
+ */
+kmem_cache_t* kmem_cache_get_by_object(heap_t* heap, void* object) {
+    kmem_slab_t* slab = kmem_slab_get_by_object(heap, object);
+    return slab ? slab->cache : NULL;
+}
+
+/**
+ * @brief Give the empty slabs of a cache back to its heap.
+ * @param cache Pointer to the cache.
+ * @return The number of heap blocks freed.
+ */
+uint32_t kmem_cache_shrink(kmem_cache_t* cache) {
+    if (!cache) {
+        return 0;
+    }
+
+    uint32_t freed_blocks = 0;
+    while (cache->slabs_empty) {
+        kmem_slab_t* slab = cache->slabs_empty;
+        kmem_slab_list_remove(&cache->slabs_empty, slab);
+        heap_free(cache->heap, slab);
+        cache->num_slabs--;
+        freed_blocks += cache->slab_blocks;
+    }
+    return freed_blocks;
+}
@@ -0,0 +1,68 @@
+#ifndef __SLAB_H__
+#define __SLAB_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "status.h"
+#include "config.h"
+#include "heap.h"
+
+/**
+ * The slab layer carves heap allocations into equally sized objects:
+ * 1. A cache serves objects of one size. Its memory comes in slabs, where a slab is one
+ *    allocation of a few contiguous heap blocks obtained from heap_malloc.
+ * 2. Every slab starts with a kmem_slab_t header followed by the objects. Free objects
+ *    are chained through their first word.
+ * 3. Slabs are kept on three lists (partial, full, empty) so that allocation and free
+ *    are O(1). At most one empty slab is kept around; the others go back to the heap.
+ *    kmem_cache_shrink releases that last one too, e.g. under memory pressure.
+ * 4. Since the header sits at the start of the heap allocation, an object never does.
+ *    That is how the owning cache of any pointer is recovered from the heap block table.
+ */
+
+#define KMEM_CACHE_NAME_LENGTH 16
+#define KMEM_SLAB_MAGIC 0x51AB51AB
+#define KMEM_SLAB_MAX_BLOCKS 8
+#define KMEM_OBJECT_ALIGNMENT 8
+
+/**
+ * @brief Optional constructor called on every object handed out by a cache.
+ * @param object Pointer to the object.
+ */
+typedef void (*kmem_cache_ctor_t)(void* object);
+
+typedef struct kmem_cache kmem_cache_t; // Forward declaration
+
+// Header at the start of every slab
+typedef struct kmem_slab {
+    uint32_t magic;             // KMEM_SLAB_MAGIC, guards against foreign pointers
+    kmem_cache_t* cache;        // Owning cache
+    struct kmem_slab* next;     // Next slab in the same list
+    struct kmem_slab* prev;     // Previous slab in the same list
+    void* free_objects;         // Singly linked list of free objects
+    uint32_t in_use;            // Number of objects handed out
+} kmem_slab_t;
+
+// Cache of equally sized objects
+typedef struct kmem_cache {
+    char name[KMEM_CACHE_NAME_LENGTH];
+    heap_t* heap;               // Heap the slabs are allocated from
+    size_t object_size;         // Object size rounded up to KMEM_OBJECT_ALIGNMENT
+    uint32_t objects_per_slab;
+    uint32_t slab_blocks;       // Heap blocks per slab
+    kmem_cache_ctor_t ctor;
+    kmem_slab_t* slabs_partial; // Slabs with both used and free objects
+    kmem_slab_t* slabs_full;    // Slabs without free objects
+    kmem_slab_t* slabs_empty;   // Slabs without used objects
+    uint32_t num_slabs;         // Slabs currently allocated from the heap
+    uint32_t objects_in_use;    // Objects handed out and not freed yet
+    struct kmem_cache* next;    // Next cache in the owner's list of caches, for diagnostics
+} kmem_cache_t;
+
+error_t kmem_cache_init(kmem_cache_t* cache, heap_t* heap, const char* name, size_t object_size, kmem_cache_ctor_t ctor);
+void* kmem_cache_alloc(kmem_cache_t* cache);
+void kmem_cache_free(kmem_cache_t* cache, void* object);
+kmem_cache_t* kmem_cache_get_by_object(heap_t* heap, void* object);
+uint32_t kmem_cache_shrink(kmem_cache_t* cache);
+
+#endif // __SLAB_H__
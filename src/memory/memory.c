@@ -31,6 +31,28 @@ void* memcpy(void *dest, const void *src, size_t num) {
     return dest;
 }
 
+/**
+ * @brief Copies num bytes from memory area src to memory area dest. The areas may overlap.
+ * @param dest Pointer to the destination memory area.
+ * @param src Pointer to the source memory area.
+ * @param num Number of bytes to copy.
+ * @return A pointer to the destination memory area dest.
+ */
+void* memmove(void *dest, const void *src, size_t num) {
+    uint8_t *d = (uint8_t *)dest;
+    const uint8_t *s = (const uint8_t *)src;
+    if (d <= s) {
+        for (size_t i = 0; i < num; i++) {
+            d[i] = s[i];
+        }
+    } else {
+        for (size_t i = num; i > 0; i--) {
+            d[i - 1] = s[i - 1];
+        }
+    }
+    return dest;
+}
+
 /**
  * @brief Compares the first num bytes of two memory areas.
  * @param ptr1 Pointer to the first memory area.
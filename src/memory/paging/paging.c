@@ -1,17 +1,23 @@
 #include "memory/paging/paging.h"
 #include "memory/heap/kheap.h"
+#include "memory/frame/frame.h"
+#include "memory/memory.h"
 
 extern void paging_load_directory(paging_descriptor_entry_t* directory);
 
 paging_4gb_chunk_t* paging_current_chunk = NULL;
 
 /**
- * @brief Get the address of the page directory from a 4GB paging chunk.
+ * @brief Get the address of the top level paging structure from a 4GB paging chunk, as loaded into CR3.
  * @param chunk Pointer to the paging 4GB chunk.
- * @return Address of the page directory.
+ * @return Address of the page directory, or of the PDPT in PAE mode.
  */
 static inline paging_descriptor_entry_t* paging_4gb_chunk_get_directory_address(paging_4gb_chunk_t* chunk) {
+#if PAGING_PAE_ENABLED
+    return chunk->pdpt;
+#else
     return chunk->directory_ptr;
+#endif
 }
 
 /**
@@ -26,90 +32,217 @@ int paging_get_indexes_from_address(uint32_t virtual_address, uint32_t* director
         return -EINVAL; // Address is not aligned to page size
     }
 
-    *directory_index = virtual_address / (PAGE_SIZE * PAGE_ENTRIES_PER_TABLE); // 4MB per directory entry
-    *table_index = (virtual_address % (PAGE_SIZE * PAGE_ENTRIES_PER_TABLE)) / PAGE_SIZE; // 4KB per page
+    *directory_index = virtual_address / PAGING_LARGE_PAGE_SIZE; // 4MB (2MB with PAE) per directory entry
+    *table_index = (virtual_address % PAGING_LARGE_PAGE_SIZE) / PAGE_SIZE; // 4KB per page
 
     return ENONE;
 }
 
 /**
- * @brief Initialize a 4GB paging chunk with 4KB pages.
+ * @brief Allocate a page-aligned paging structure (page directory or page table).
+ * @param arena Arena to allocate from, or NULL to take a frame of the frame allocator.
+ *        Structures larger than a page (the PAE page directory) come from the kernel heap then.
+ * @param size Size of the structure in bytes.
+ * @param zeroed true to get the structure filled with zeros, e.g. from the pre-zeroed frames.
+ * @return Pointer to the structure, or NULL if allocation fails. Its content is undefined unless zeroed.
  */
-paging_4gb_chunk_t* paging_4gb_chunk_init(uint8_t flags) {
+static paging_descriptor_entry_t* paging_alloc_table(arena_t* arena, size_t size, bool zeroed) {
+    if (arena) {
+        void* table = arena_alloc_aligned(arena, size, PAGE_SIZE);
+        if (table && zeroed) {
+            memset(table, 0, size);
+        }
+        return (paging_descriptor_entry_t*)table;
+    }
+    if (size > PAGE_SIZE) {
+        return (paging_descriptor_entry_t*)(zeroed ? kheap_zmalloc_pages(size) : kheap_malloc_pages(size));
+    }
+    return (paging_descriptor_entry_t*)(zeroed ? frame_zalloc() : frame_alloc());
+}
+
+/**
+ * @brief Free a paging structure allocated by paging_alloc_table without an arena.
+ * @param table Pointer to the structure.
+ * @param size Size of the structure in bytes, as allocated.
+ */
+static void paging_free_table(paging_descriptor_entry_t* table, size_t size) {
+    if (size > PAGE_SIZE) {
+        kheap_free(table);
+    } else {
+        frame_free(table);
+    }
+}
+
+/**
+ * @brief Allocate a paging chunk structure and its page directory.
+ *        The directory is left uninitialized, the caller writes all PAGING_DIRECTORY_ENTRIES entries.
+ * @param arena Arena to allocate from, or NULL to allocate it from the kernel heap and the directory from the frame allocator.
+ * @return Pointer to the chunk, or NULL on failure.
+ */
+static paging_4gb_chunk_t* paging_4gb_chunk_alloc(arena_t* arena) {
     // Allocate a chunk structure
-    paging_4gb_chunk_t* chunk = (paging_4gb_chunk_t*)kheap_zmalloc(sizeof(paging_4gb_chunk_t));
+    paging_4gb_chunk_t* chunk = arena ?
+        (paging_4gb_chunk_t*)arena_zalloc(arena, sizeof(paging_4gb_chunk_t)) :
+        (paging_4gb_chunk_t*)kheap_zmalloc(sizeof(paging_4gb_chunk_t));
     if (!chunk) {
-        // Handle allocation failure (e.g., log it, halt the system, etc.)
         return NULL;
     }
+    chunk->arena = arena;
 
-    // prepare page directory table
-    paging_descriptor_entry_t* page_directory = (paging_descriptor_entry_t*)kheap_zmalloc(PAGE_DIRECTORY_SIZE);
+    // prepare page directory table, not cleared since every entry is written by the caller
+    paging_descriptor_entry_t* page_directory = paging_alloc_table(arena, PAGING_DIRECTORY_SIZE, false);
     if (!page_directory) {
+        if (!arena) {
+            kheap_free(chunk);
+        }
+        // Arena memory is released together with the arena by its owner
+        return NULL;
+    }
+    chunk->directory_ptr = page_directory;
+
+#if PAGING_PAE_ENABLED
+    // The PDPT points at the four page directories, which never change
+    chunk->pdpt = (paging_descriptor_entry_t*)(((uintptr_t)chunk->pdpt_storage + 31) & ~(uintptr_t)31);
+    for (uint32_t i = 0; i < PAGING_PDPT_ENTRIES; i++) {
+        chunk->pdpt[i] = (uintptr_t)(page_directory + i * PAGING_TABLE_ENTRIES) | PAGING_FLAG_PRESENT;
+    }
+#endif
+    return chunk;
+}
+
+/**
+ * @brief Initialize an identity mapped 4GB paging chunk.
+ *        Every 4MB (2MB with PAE) region is mapped by a single large page (PAGING_FLAG_PAGE_SIZE), so no page
+ *        table is allocated up front. A region gets a table once a 4KB page in it is changed.
+ *        PAGING_FLAG_GLOBAL is left out for regions overlapping the program virtual space,
+ *        where processes map their own pages.
+ * @param flags Flags of every directory entry.
+ * @return Pointer to the chunk, or NULL on failure. Free it with paging_4gb_chunk_free.
+ */
+paging_4gb_chunk_t* paging_4gb_chunk_init(uint32_t flags) {
+    paging_4gb_chunk_t* chunk = paging_4gb_chunk_alloc(NULL);
+    if (!chunk) {
         // Handle allocation failure (e.g., log it, halt the system, etc.)
-        goto cleanup;
+        return NULL;
     }
 
-    // Map descriptors to page tables
-    for (uint32_t i = 0; i < PAGE_ENTRIES_PER_TABLE; i++) {
-        // Allocate a page table
-        paging_descriptor_entry_t* page_table = (paging_descriptor_entry_t*)kheap_zmalloc(PAGE_TABLE_SIZE);
-        if (!page_table) {
-            // Handle allocation failure (e.g., log it, halt the system, etc.)
-            page_directory = NULL;
-            goto cleanup;
+    for (uint32_t i = 0; i < PAGING_DIRECTORY_ENTRIES; i++) {
+        uint32_t address = i * PAGING_LARGE_PAGE_SIZE;
+        uint32_t page_flags = flags | PAGING_FLAG_PAGE_SIZE;
+        if (address < PROGRAM_VIRTUAL_SPACE_END_ADDRESS && address + PAGING_LARGE_PAGE_SIZE > PROGRAM_VIRTUAL_SPACE_START_ADDRESS) {
+            page_flags &= ~PAGING_FLAG_GLOBAL;
         }
+        chunk->directory_ptr[i] = address | page_flags;
+    }
 
-        // Map the page table to the page directory
-        page_directory[i] = (paging_descriptor_entry_t)page_table | flags;
+    return chunk;
+}
 
-        // Initialize the page table entries
-        for (uint32_t j = 0; j < PAGE_ENTRIES_PER_TABLE; j++) {
-            page_table[j] = ((i * PAGE_ENTRIES_PER_TABLE * PAGE_SIZE) + (j * PAGE_SIZE)) | flags;
-        }
+/**
+ * @brief Initialize a 4GB paging chunk which shares the page tables of another chunk.
+ *        Only the page directory is allocated. Every 4MB region starts out mapped exactly
+ *        like in the shared chunk, by pointing at its page table, and changes made to the
+ *        shared chunk later are seen through it. A private table is only allocated when
+ *        this chunk changes a mapping of the region (see paging_get_private_table).
+ *        The directory entries are copied, so the shared chunk must not replace any of them
+ *        (e.g. by splitting a large page) once other chunks share it. Its page table entries
+ *        may change at any time.
+ * @param arena Arena owning the chunk and its private tables, or NULL to allocate them from the kernel heap and the frame allocator.
+ *        Arena-owned chunks live as long as the arena: paging_4gb_chunk_free leaves them alone.
+ * @param shared_chunk Pointer to the chunk whose tables are shared, typically the kernel's.
+ * @return Pointer to the chunk, or NULL on failure.
+ */
+paging_4gb_chunk_t* paging_4gb_chunk_init_shared(arena_t* arena, paging_4gb_chunk_t* shared_chunk) {
+    if (!shared_chunk) {
+        return NULL;
     }
 
-    chunk->directory_ptr = page_directory;
+    paging_4gb_chunk_t* chunk = paging_4gb_chunk_alloc(arena);
+    if (!chunk) {
+        return NULL;
+    }
 
+    // The tables stay owned by the shared chunk
+    for (uint32_t i = 0; i < PAGING_DIRECTORY_ENTRIES; i++) {
+        chunk->directory_ptr[i] = shared_chunk->directory_ptr[i] & ~PAGING_FLAG_OWNED;
+    }
     return chunk;
+}
 
-// Free allocated resources to prevent memory leaks
-cleanup:
-    if (page_directory) {
-        for (uint32_t i = 0; i < PAGE_ENTRIES_PER_TABLE; i++) {
-            if (page_directory[i]) {
-                kheap_free((void*)(page_directory[i] & ~0xFFF));
-            }
-        }
+/**
+ * @brief Get the page table of a 4MB (2MB with PAE) region which the chunk may change.
+ *        A table shared with another chunk is replaced by a private copy first, a large
+ *        page is split into a table of 4KB pages mapping the same frames and a region
+ *        without a table gets an empty one.
+ * @param chunk Pointer to the paging 4GB chunk.
+ * @param directory_index Index of the region in the page directory.
+ * @return Pointer to the page table, or NULL if allocation fails.
+ */
+static paging_descriptor_entry_t* paging_get_private_table(paging_4gb_chunk_t* chunk, uint32_t directory_index) {
+    paging_descriptor_entry_t directory_entry = chunk->directory_ptr[directory_index];
+    if (directory_entry & PAGING_FLAG_OWNED) {
+        return (paging_descriptor_entry_t*)PAGING_ENTRY_GET_ADDRESS(directory_entry);
     }
 
-    if (chunk) {
-        kheap_free((void*)chunk);
+    // Only a region without a table starts out with an empty one, the others are filled below
+    bool empty = !(directory_entry & PAGING_FLAG_PRESENT);
+    paging_descriptor_entry_t* page_table = paging_alloc_table(chunk->arena, PAGE_TABLE_SIZE, empty);
+    if (!page_table) {
+        return NULL;
+    }
+
+    // Access rights are enforced by the table entries, the directory entry lets everything through
+    uint32_t flags = PAGING_FLAG_PRESENT | PAGING_FLAG_WRITABLE | PAGING_FLAG_USER;
+    if ((directory_entry & PAGING_FLAG_PRESENT) && (directory_entry & PAGING_FLAG_PAGE_SIZE)) {
+        paging_descriptor_entry_t frame = directory_entry & PAGING_LARGE_PAGE_FRAME_MASK;
+        flags = directory_entry & 0xFFF & ~PAGING_FLAG_PAGE_SIZE;
+        for (uint32_t i = 0; i < PAGING_TABLE_ENTRIES; i++) {
+            page_table[i] = (frame + i * PAGE_SIZE) | flags;
+        }
+        flags &= ~(PAGING_FLAG_GLOBAL | PAGING_FLAG_DIRTY);
+    } else if (!empty) {
+        memcpy(page_table, (void*)PAGING_ENTRY_GET_ADDRESS(directory_entry), PAGE_TABLE_SIZE);
+        flags = directory_entry & 0xFFF;
     }
-    return NULL;
+    chunk->directory_ptr[directory_index] = (uintptr_t)page_table | flags | PAGING_FLAG_OWNED;
+    return page_table;
 }
 
 /**
  * @brief Switch to a different 4GB paging chunk.
+ *        Nothing is done if the chunk is already loaded, since every CR3 load flushes the TLB.
  * @param chunk Pointer to the paging 4GB chunk to switch to.
  */
 void paging_switch_4gb_chunk(paging_4gb_chunk_t* chunk) {
+    if (chunk == paging_current_chunk) {
+        return;
+    }
     paging_descriptor_entry_t* directory_address = paging_4gb_chunk_get_directory_address(chunk);
     paging_load_directory(directory_address);
     paging_current_chunk = chunk;
 }
 
+/**
+ * @brief Get the paging chunk currently loaded in CR3.
+ * @return Pointer to the paging 4GB chunk, or NULL before the first switch.
+ */
+paging_4gb_chunk_t* paging_get_current_4gb_chunk() {
+    return paging_current_chunk;
+}
+
 /**
  * @brief Map a virtual address to a physical address in the given paging chunk.
+ *        The TLB entry of the page is invalidated, since the change may be visible in the
+ *        loaded address space (the chunk itself or one sharing the page table).
  * @param chunk Pointer to the paging 4GB chunk.
  * @param virtual_address The virtual address to map (should be aligned to page size).
  * @param value The pointer to the physical address with flags.
- * @return ENONE on success, or -EINVAL on failure.
+ * @return ENONE on success, -EINVAL on invalid arguments or -ENOMEM if a private page table cannot be allocated.
  */
 int paging_map_virtual_address(
     paging_4gb_chunk_t* chunk,
     uint32_t virtual_address,
-    uint32_t value) {
+    paging_descriptor_entry_t value) {
     if (!chunk || !value) {
         return -EINVAL;
     }
@@ -119,15 +252,15 @@ int paging_map_virtual_address(
         return -EINVAL;
     }
 
-    // Remove the flags from the page table address first
-    paging_descriptor_entry_t* page_table =
-        (paging_descriptor_entry_t*)(chunk->directory_ptr[directory_index] & ~0xFFF);
+    // Never write through a table shared with another chunk
+    paging_descriptor_entry_t* page_table = paging_get_private_table(chunk, directory_index);
     if (!page_table) {
-        return -EINVAL;
+        return -ENOMEM;
     }
 
     // Set the new page frame with flags which stores the physical address and flags
     page_table[table_index] = value;
+    paging_invalidate_tlb_entry(virtual_address);
 
     return ENONE;
 }
@@ -154,29 +287,57 @@ void paging_align_address_to_page_size(uint32_t* address) {
 }
 
 /**
- * @brief Free a 4GB paging chunk and its associated page tables.
+ * @brief Free a 4GB paging chunk and the page tables it owns. Shared tables are left alone.
  * @param chunk Pointer to the paging 4GB chunk to free.
  */
 void paging_4gb_chunk_free(paging_4gb_chunk_t* chunk) {
-    if (!chunk) {
-        return;
+    if (!chunk || chunk->arena) {
+        return; // Tables owned by an arena go away with the arena
     }
 
     paging_descriptor_entry_t* page_directory = chunk->directory_ptr;
     if (page_directory) {
-        for (uint32_t i = 0; i < PAGE_ENTRIES_PER_TABLE; i++) {
-            if (page_directory[i]) {
-                kheap_free((void*)(page_directory[i] & ~0xFFF));
+        for (uint32_t i = 0; i < PAGING_DIRECTORY_ENTRIES; i++) {
+            if (page_directory[i] & PAGING_FLAG_OWNED) {
+                paging_free_table((paging_descriptor_entry_t*)PAGING_ENTRY_GET_ADDRESS(page_directory[i]), PAGE_TABLE_SIZE);
             }
         }
-        kheap_free((void*)page_directory);
+        paging_free_table(page_directory, PAGING_DIRECTORY_SIZE);
     }
 
     kheap_free((void*)chunk);
 }
 
+/**
+ * @brief Map a whole 4MB (2MB with PAE) region of the given paging chunk with a single large page.
+ *        A table the chunk owned for the region is released, and every TLB entry the
+ *        region may still have from it is invalidated.
+ * @param chunk Pointer to the paging 4GB chunk.
+ * @param directory_index Index of the region in the page directory.
+ * @param value The PAGING_LARGE_PAGE_SIZE aligned physical address with flags, PAGING_FLAG_PAGE_SIZE is added.
+ */
+static void paging_map_large_page(paging_4gb_chunk_t* chunk, uint32_t directory_index, paging_descriptor_entry_t value) {
+    paging_descriptor_entry_t directory_entry = chunk->directory_ptr[directory_index];
+    chunk->directory_ptr[directory_index] = value | PAGING_FLAG_PAGE_SIZE;
+
+    uint32_t virtual_address = directory_index * PAGING_LARGE_PAGE_SIZE;
+    if ((directory_entry & PAGING_FLAG_PRESENT) && !(directory_entry & PAGING_FLAG_PAGE_SIZE)) {
+        for (uint32_t i = 0; i < PAGING_TABLE_ENTRIES; i++) {
+            paging_invalidate_tlb_entry(virtual_address + i * PAGE_SIZE);
+        }
+        if ((directory_entry & PAGING_FLAG_OWNED) && !chunk->arena) {
+            // Arena tables go away with the arena
+            paging_free_table((paging_descriptor_entry_t*)PAGING_ENTRY_GET_ADDRESS(directory_entry), PAGE_TABLE_SIZE);
+        }
+    } else {
+        paging_invalidate_tlb_entry(virtual_address);
+    }
+}
+
 /**
  * @brief Map a range of virtual addresses to physical addresses in the given paging chunk.
+ *        Every 4MB (2MB with PAE) region which the range covers completely, with both addresses
+ *        aligned to PAGING_LARGE_PAGE_SIZE, is mapped by a large page. The rest is mapped with 4KB pages.
  * @param chunk Pointer to the paging 4GB chunk.
  * @param virtual_address_start The starting virtual address to map (should be aligned to page size).
  * @param physical_address_start The starting physical address to map to (should be aligned to page size).
@@ -200,16 +361,25 @@ int paging_map_virtual_addresses(
     }
 
     size_t pages_to_map = (size + PAGE_SIZE - 1) / PAGE_SIZE; // Round up to the nearest page
+    bool large_pages_allowed = ((virtual_address_start ^ physical_address_start) & (PAGING_LARGE_PAGE_SIZE - 1)) == 0 &&
+                               !(flags & (PAGING_FLAG_OWNED | PAGING_FLAG_SWAPPED));
 
-    for (size_t i = 0; i < pages_to_map; i++) {
+    for (size_t i = 0; i < pages_to_map; ) {
         uint32_t virtual_address = virtual_address_start + (i * PAGE_SIZE);
         uint32_t physical_address = physical_address_start + (i * PAGE_SIZE);
-        uint32_t value = physical_address | flags;
 
-        int res = paging_map_virtual_address(chunk, virtual_address, value);
+        if (large_pages_allowed && (virtual_address & (PAGING_LARGE_PAGE_SIZE - 1)) == 0 &&
+            pages_to_map - i >= PAGING_TABLE_ENTRIES) {
+            paging_map_large_page(chunk, virtual_address / PAGING_LARGE_PAGE_SIZE, physical_address | flags);
+            i += PAGING_TABLE_ENTRIES;
+            continue;
+        }
+
+        int res = paging_map_virtual_address(chunk, virtual_address, physical_address | flags);
         if (res != ENONE) {
             return res;
         }
+        i++;
     }
 
     return ENONE;
@@ -221,7 +391,7 @@ int paging_map_virtual_addresses(
  * @param virtual_address The virtual address to look up.
  * @return The page table entry value, or 0 if not found or on error.
  */
-uint32_t paging_get_page_entry(paging_4gb_chunk_t* chunk, uint32_t virtual_address) {
+paging_descriptor_entry_t paging_get_page_entry(paging_4gb_chunk_t* chunk, uint32_t virtual_address) {
     if (!chunk) {
         return 0;
     }
@@ -231,12 +401,68 @@ uint32_t paging_get_page_entry(paging_4gb_chunk_t* chunk, uint32_t virtual_addre
         return 0;
     }
 
+    // A large page is reported as the 4KB page entry it stands for
+    paging_descriptor_entry_t directory_entry = chunk->directory_ptr[directory_index];
+    if ((directory_entry & PAGING_FLAG_PRESENT) && (directory_entry & PAGING_FLAG_PAGE_SIZE)) {
+        return ((directory_entry & PAGING_LARGE_PAGE_FRAME_MASK) + table_index * PAGE_SIZE) |
+               (directory_entry & 0xFFF & ~PAGING_FLAG_PAGE_SIZE);
+    }
+
     // Remove the flags from the page table address first
-    paging_descriptor_entry_t* page_table =
-        (paging_descriptor_entry_t*)(chunk->directory_ptr[directory_index] & ~0xFFF);
+    paging_descriptor_entry_t* page_table = (paging_descriptor_entry_t*)PAGING_ENTRY_GET_ADDRESS(directory_entry);
     if (!page_table) {
         return 0;
     }
 
     return page_table[table_index];
+}
+
+/**
+ * @brief Unmap a virtual address in the given paging chunk, i.e. clear its page table entry,
+ *        and invalidate the TLB entry of the page.
+ * @param chunk Pointer to the paging 4GB chunk.
+ * @param virtual_address The virtual address to unmap (should be aligned to page size).
+ * @return ENONE on success, -EINVAL on invalid arguments or -ENOMEM if a private page table cannot be allocated.
+ */
+int paging_unmap_virtual_address(paging_4gb_chunk_t* chunk, uint32_t virtual_address) {
+    if (!chunk) {
+        return -EINVAL;
+    }
+
+    uint32_t directory_index, table_index;
+    if (paging_get_indexes_from_address(virtual_address, &directory_index, &table_index) != ENONE) {
+        return -EINVAL;
+    }
+
+    paging_descriptor_entry_t directory_entry = chunk->directory_ptr[directory_index];
+    if (!(directory_entry & PAGING_FLAG_PRESENT)) {
+        return ENONE; // Nothing mapped in the whole region
+    }
+    paging_descriptor_entry_t* page_table = paging_get_private_table(chunk, directory_index);
+    if (!page_table) {
+        return -ENOMEM;
+    }
+
+    page_table[table_index] = 0;
+    paging_invalidate_tlb_entry(virtual_address);
+
+    return ENONE;
+}
+
+/**
+ * @brief Translate a virtual address to the physical address it is mapped to in the given paging chunk.
+ * @param chunk Pointer to the paging 4GB chunk.
+ * @param virtual_address The virtual address to translate (any alignment).
+ * @return The physical address, or 0 if the address is not mapped.
+ */
+uint32_t paging_get_physical_address(paging_4gb_chunk_t* chunk, uint32_t virtual_address) {
+    uint32_t page_address = virtual_address;
+    paging_align_address_to_page_size(&page_address);
+
+    paging_descriptor_entry_t entry = paging_get_page_entry(chunk, page_address);
+    if (!(entry & PAGING_FLAG_PRESENT)) {
+        return 0;
+    }
+
+    return PAGING_ENTRY_GET_ADDRESS(entry) | (virtual_address - page_address);
 }
\ No newline at end of file
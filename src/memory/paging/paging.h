@@ -6,6 +6,7 @@
 #include <stdbool.h>
 #include "config.h"
 #include "status.h"
+#include "memory/arena/arena.h"
 
 #define PAGING_FLAG_PRESENT        0b00000001
 #define PAGING_FLAG_WRITABLE       0b00000010
@@ -15,25 +16,65 @@
 #define PAGING_FLAG_ACCESSED       0b00100000
 #define PAGING_FLAG_DIRTY          0b01000000
 #define PAGING_FLAG_PAGE_SIZE      0b10000000
+#define PAGING_FLAG_GLOBAL         0x100 // Translation kept in the TLB across CR3 loads (CR4.PGE)
+// Bits 9-11 of an entry are ignored by the MMU and left to the kernel
+#define PAGING_FLAG_OWNED          0x200 // Present page whose frame belongs to the address space and is freed with it.
+                                         // In a directory entry: page table owned by the chunk rather than shared
+#define PAGING_FLAG_SWAPPED        0x400 // Not present page compressed by zram, bits 12-31 hold its zram slot
+#define PAGING_FLAG_COW            0x800 // Read-only owned page whose frame may be shared, copied on the first write (see cow.h)
 
-// Type definitions
 /**
- * @brief Paging descriptor type (page directory or page table entry).
+ * Paging modes, chosen with PAGING_PAE_ENABLED in config.h:
+ * - 32-bit: a page directory of 1024 entries and page tables of 1024 32-bit entries.
+ *   Large pages map 4MB (CR4.PSE).
+ * - PAE: a page directory pointer table (PDPT) of 4 entries, each pointing at a page directory
+ *   of 512 entries for 1GB, and page tables of 512 64-bit entries. Large pages map 2MB.
+ *   The four directories are allocated back to back, so that they form a single directory of
+ *   2048 entries and the rest of the code is the same for both modes. Entries hold physical
+ *   addresses of up to 52 bits.
  */
+#if PAGING_PAE_ENABLED
+typedef uint64_t paging_descriptor_entry_t;
+#define PAGING_PDPT_ENTRIES 4
+#define PAGING_DIRECTORY_ENTRIES (PAGING_PDPT_ENTRIES * PAGING_TABLE_ENTRIES)
+#define PAGING_TABLE_ENTRIES 512
+#define PAGING_FRAME_MASK 0x000FFFFFFFFFF000ULL
+#else
 typedef uint32_t paging_descriptor_entry_t;
+#define PAGING_DIRECTORY_ENTRIES PAGE_ENTRIES_PER_TABLE
+#define PAGING_TABLE_ENTRIES PAGE_ENTRIES_PER_TABLE
+#define PAGING_FRAME_MASK 0xFFFFF000
+#endif
+#define PAGING_DIRECTORY_SIZE (PAGING_DIRECTORY_ENTRIES * sizeof(paging_descriptor_entry_t))
+// Large pages: a directory entry with PAGING_FLAG_PAGE_SIZE maps a whole table worth of pages directly
+#define PAGING_LARGE_PAGE_SIZE (PAGE_SIZE * PAGING_TABLE_ENTRIES)
+#define PAGING_LARGE_PAGE_FRAME_MASK (PAGING_FRAME_MASK & ~(paging_descriptor_entry_t)(PAGING_LARGE_PAGE_SIZE - 1))
+// Address of the table or frame an entry points at, for the kernel which only reaches the first 4GB
+#define PAGING_ENTRY_GET_ADDRESS(entry) ((uintptr_t)((entry) & PAGING_FRAME_MASK))
+
+// Type definitions
 typedef struct paging_4gb_chunk {
-    paging_descriptor_entry_t* directory_ptr; // Pointer to the page directory
+    paging_descriptor_entry_t* directory_ptr; // Pointer to the page directory, tables not marked owned are shared
+    arena_t* arena; // Arena owning the chunk and its tables, or NULL if they come from the kernel heap
+#if PAGING_PAE_ENABLED
+    paging_descriptor_entry_t* pdpt; // Loaded into CR3, 32-byte aligned inside pdpt_storage
+    paging_descriptor_entry_t pdpt_storage[PAGING_PDPT_ENTRIES * 2];
+#endif
 } paging_4gb_chunk_t;
 
 // Exported function prototypes
-paging_4gb_chunk_t* paging_4gb_chunk_init(uint8_t flags);
+paging_4gb_chunk_t* paging_4gb_chunk_init(uint32_t flags);
+paging_4gb_chunk_t* paging_4gb_chunk_init_shared(arena_t* arena, paging_4gb_chunk_t* shared_chunk);
 void paging_switch_4gb_chunk(paging_4gb_chunk_t* chunk);
-int paging_map_virtual_address(paging_4gb_chunk_t* chunk, uint32_t virtual_address, uint32_t value);
+paging_4gb_chunk_t* paging_get_current_4gb_chunk();
+int paging_map_virtual_address(paging_4gb_chunk_t* chunk, uint32_t virtual_address, paging_descriptor_entry_t value);
 bool paging_is_aligned_to_page_size(uint32_t address);
 void paging_align_address_to_page_size(uint32_t* address);
 void paging_4gb_chunk_free(paging_4gb_chunk_t* chunk);
 int paging_map_virtual_addresses(paging_4gb_chunk_t* chunk, uint32_t virtual_address_start, uint32_t physical_address_start, size_t size, uint32_t flags);
-uint32_t paging_get_page_entry(paging_4gb_chunk_t* chunk, uint32_t virtual_address);
+paging_descriptor_entry_t paging_get_page_entry(paging_4gb_chunk_t* chunk, uint32_t virtual_address);
+int paging_unmap_virtual_address(paging_4gb_chunk_t* chunk, uint32_t virtual_address);
+uint32_t paging_get_physical_address(paging_4gb_chunk_t* chunk, uint32_t virtual_address);
 
 /**
  * @brief Enable paging by setting the appropriate control register.
@@ -41,4 +82,29 @@ uint32_t paging_get_page_entry(paging_4gb_chunk_t* chunk, uint32_t virtual_addre
  */
 void paging_enable();
 
+/**
+ * @brief Enable global pages by setting CR4.PGE, so that entries marked PAGING_FLAG_GLOBAL
+ *        survive CR3 loads. This function is typically implemented in assembly.
+ */
+void paging_enable_global_pages();
+
+/**
+ * @brief Enable 4MB large pages by setting CR4.PSE. Must be done before paging is enabled
+ *        on a chunk which uses them. This function is typically implemented in assembly.
+ */
+void paging_enable_large_pages();
+
+/**
+ * @brief Switch the MMU to PAE paging by setting CR4.PAE. Must be done before paging is enabled,
+ *        large pages need no other switch in this mode. This function is typically implemented in assembly.
+ */
+void paging_enable_pae();
+
+/**
+ * @brief Invalidate the TLB entry of the page containing the given virtual address (INVLPG).
+ *        This function is typically implemented in assembly.
+ * @param virtual_address The virtual address whose translation is dropped.
+ */
+void paging_invalidate_tlb_entry(uint32_t virtual_address);
+
 #endif // __PAGING_H__
\ No newline at end of file
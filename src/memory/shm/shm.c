@@ -0,0 +1,298 @@
+#include "shm.h"
+#include "memory/frame/frame.h"
+#include "memory/heap/kheap.h"
+#include "memory/memory.h"
+
+struct shm_region {
+    uint32_t id; // Index in shm_regions
+    uint32_t num_pages;
+    uint32_t ref_count; // Number of attachments
+    void* frames[]; // num_pages frames, mapped in this order
+};
+
+static shm_region_t* shm_regions[SHM_MAX_REGIONS]; // Regions by id
+
+/**
+ * @brief Initialize an address space without attached regions.
+ * @param space Pointer to the space.
+ * @param chunk The address space the regions are mapped into.
+ */
+void shm_space_init(shm_space_t* space, paging_4gb_chunk_t* chunk) {
+    if (!space) {
+        return;
+    }
+
+    memset(space, 0, sizeof(shm_space_t));
+    space->chunk = chunk;
+}
+
+/**
+ * @brief Free the frames of a region and the region itself.
+ * @param region Pointer to the region, whose frames may be partially allocated.
+ */
+static void shm_region_free(shm_region_t* region) {
+    for (uint32_t i = 0; i < region->num_pages; i++) {
+        if (region->frames[i]) {
+            frame_free(region->frames[i]);
+        }
+    }
+    if (shm_regions[region->id] == region) {
+        shm_regions[region->id] = NULL;
+    }
+    kheap_free(region);
+}
+
+/**
+ * @brief Find a free range in the shared memory window of an address space (first fit).
+ * @param space Pointer to the space.
+ * @param size Size of the range in bytes, multiple of the page size.
+ * @return The page-aligned start of the range, or 0 if the window is full.
+ */
+static uint32_t shm_find_address(shm_space_t* space, uint32_t size) {
+    uint32_t address = PROGRAM_VIRTUAL_SHM_START_ADDRESS;
+    bool moved = true;
+    while (moved) {
+        moved = false;
+        for (uint32_t i = 0; i < SHM_MAX_ATTACHMENTS; i++) {
+            shm_attachment_t* attachment = &space->attachments[i];
+            if (!attachment->region) {
+                continue;
+            }
+            uint32_t end = attachment->virtual_address + attachment->region->num_pages * PAGE_SIZE;
+            if (attachment->virtual_address < address + size && address < end) {
+                address = end; // Overlaps, try right after the attachment
+                moved = true;
+            }
+        }
+        if (address > PROGRAM_VIRTUAL_SPACE_END_ADDRESS || size > PROGRAM_VIRTUAL_SPACE_END_ADDRESS - address) {
+            return 0;
+        }
+    }
+    return address;
+}
+
+/**
+ * @brief Unmap the pages of a range, so that touching them faults again.
+ * @param chunk The address space.
+ * @param virtual_address Page-aligned start of the range.
+ * @param num_pages Number of pages.
+ */
+static void shm_unmap(paging_4gb_chunk_t* chunk, uint32_t virtual_address, uint32_t num_pages) {
+    for (uint32_t i = 0; i < num_pages; i++) {
+        paging_unmap_virtual_address(chunk, virtual_address + i * PAGE_SIZE);
+    }
+}
+
+/**
+ * @brief Map a region into an address space at a given address and take a reference to it.
+ *        Frames which follow each other physically are mapped in one go.
+ * @param space Pointer to the space.
+ * @param region Pointer to the region.
+ * @param virtual_address Page-aligned address, with enough free room for the region.
+ * @return ENONE on success, -EBUSY if the space has no free attachment slot,
+ *         or another negative error code on failure.
+ */
+static int shm_map_at(shm_space_t* space, shm_region_t* region, uint32_t virtual_address) {
+    shm_attachment_t* attachment = NULL;
+    for (uint32_t i = 0; i < SHM_MAX_ATTACHMENTS; i++) {
+        if (!space->attachments[i].region) {
+            attachment = &space->attachments[i];
+            break;
+        }
+    }
+    if (!attachment) {
+        return -EBUSY;
+    }
+
+    for (uint32_t start = 0; start < region->num_pages; ) {
+        uint32_t end = start + 1;
+        while (end < region->num_pages &&
+               (uintptr_t)region->frames[end] == (uintptr_t)region->frames[start] + (end - start) * PAGE_SIZE) {
+            end++;
+        }
+
+        int res = paging_map_virtual_addresses(
+            space->chunk,
+            virtual_address + start * PAGE_SIZE,
+            (uint32_t)region->frames[start],
+            (end - start) * PAGE_SIZE,
+            PAGING_FLAG_PRESENT | PAGING_FLAG_USER | PAGING_FLAG_WRITABLE
+        );
+        if (res < 0) {
+            shm_unmap(space->chunk, virtual_address, end);
+            return res;
+        }
+        start = end;
+    }
+
+    attachment->region = region;
+    attachment->virtual_address = virtual_address;
+    region->ref_count++;
+    return ENONE;
+}
+
+/**
+ * @brief Map a region into an address space wherever its window has room.
+ * @param space Pointer to the space.
+ * @param region Pointer to the region.
+ * @param out_address Pointer to store the address the region is mapped at.
+ * @return ENONE on success, -ENOMEM if the window is full, or another negative error code on failure.
+ */
+static int shm_map(shm_space_t* space, shm_region_t* region, uint32_t* out_address) {
+    uint32_t address = shm_find_address(space, region->num_pages * PAGE_SIZE);
+    if (!address) {
+        return -ENOMEM;
+    }
+
+    int res = shm_map_at(space, region, address);
+    if (res == ENONE) {
+        *out_address = address;
+    }
+    return res;
+}
+
+/**
+ * @brief Create a region of zeroed frames and attach it to an address space.
+ * @param space Pointer to the space of the creator.
+ * @param size Size of the region in bytes, rounded up to whole pages.
+ * @param out_id Pointer to store the id other address spaces attach the region with.
+ * @param out_address Pointer to store the address the region is mapped at.
+ * @return ENONE on success, -EINVAL for an empty or too large size, -EBUSY if all regions
+ *         are in use, -ENOMEM if memory runs out, or another negative error code on failure.
+ */
+int shm_create(shm_space_t* space, size_t size, uint32_t* out_id, uint32_t* out_address) {
+    int res = ENONE;
+    shm_region_t* region = NULL;
+
+    if (!space || !space->chunk || !out_id || !out_address ||
+        size == 0 || size > PROGRAM_VIRTUAL_SPACE_END_ADDRESS - PROGRAM_VIRTUAL_SHM_START_ADDRESS) {
+        return -EINVAL;
+    }
+
+    uint32_t id = 0;
+    while (id < SHM_MAX_REGIONS && shm_regions[id]) {
+        id++;
+    }
+    if (id == SHM_MAX_REGIONS) {
+        return -EBUSY;
+    }
+
+    uint32_t num_pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    region = (shm_region_t*)kheap_zmalloc(sizeof(shm_region_t) + num_pages * sizeof(void*));
+    if (!region) {
+        return -ENOMEM;
+    }
+    region->id = id;
+    region->num_pages = num_pages;
+
+    // Zeroed, so that a region never shows what the frames held before
+    for (uint32_t i = 0; i < num_pages; i++) {
+        region->frames[i] = frame_zalloc();
+        if (!region->frames[i]) {
+            res = -ENOMEM;
+            goto exit;
+        }
+    }
+
+    res = shm_map(space, region, out_address);
+    if (res < 0) {
+        goto exit;
+    }
+    shm_regions[id] = region;
+    *out_id = id;
+
+exit:
+    if (res < 0) {
+        shm_region_free(region);
+    }
+    return res;
+}
+
+/**
+ * @brief Attach an existing region to an address space.
+ * @param space Pointer to the space.
+ * @param id Id of the region, as returned by shm_create.
+ * @param out_address Pointer to store the address the region is mapped at.
+ * @return ENONE on success, -ENOTFOUND if there is no region with the id, -EBUSY if the space
+ *         has no free attachment slot, -ENOMEM if its window is full, or another negative error code.
+ */
+int shm_attach(shm_space_t* space, uint32_t id, uint32_t* out_address) {
+    if (!space || !space->chunk || !out_address) {
+        return -EINVAL;
+    }
+    if (id >= SHM_MAX_REGIONS || !shm_regions[id]) {
+        return -ENOTFOUND;
+    }
+
+    return shm_map(space, shm_regions[id], out_address);
+}
+
+/**
+ * @brief Detach the region mapped at an address from an address space.
+ *        The region is freed with its frames when this was its last attachment.
+ * @param space Pointer to the space.
+ * @param virtual_address Address the region is mapped at, as returned by shm_create or shm_attach.
+ * @return ENONE on success, -ENOTFOUND if no region is attached at the address.
+ */
+int shm_detach(shm_space_t* space, uint32_t virtual_address) {
+    if (!space) {
+        return -EINVAL;
+    }
+
+    for (uint32_t i = 0; i < SHM_MAX_ATTACHMENTS; i++) {
+        shm_attachment_t* attachment = &space->attachments[i];
+        if (!attachment->region || attachment->virtual_address != virtual_address) {
+            continue;
+        }
+
+        shm_region_t* region = attachment->region;
+        shm_unmap(space->chunk, virtual_address, region->num_pages);
+        attachment->region = NULL;
+        attachment->virtual_address = 0;
+        if (--region->ref_count == 0) {
+            shm_region_free(region);
+        }
+        return ENONE;
+    }
+    return -ENOTFOUND;
+}
+
+/**
+ * @brief Detach all regions of an address space, e.g. when its process goes away.
+ * @param space Pointer to the space.
+ */
+void shm_detach_all(shm_space_t* space) {
+    if (!space) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < SHM_MAX_ATTACHMENTS; i++) {
+        if (space->attachments[i].region) {
+            shm_detach(space, space->attachments[i].virtual_address);
+        }
+    }
+}
+
+/**
+ * @brief Attach the regions of one address space to another at the same addresses, e.g. on fork.
+ * @param from Pointer to the space to copy the attachments of.
+ * @param to Pointer to the space to attach the regions to, without attachments yet.
+ * @return ENONE on success, negative error code on failure. Regions attached so far stay attached.
+ */
+int shm_clone_space(shm_space_t* from, shm_space_t* to) {
+    if (!from || !to || !to->chunk) {
+        return -EINVAL;
+    }
+
+    for (uint32_t i = 0; i < SHM_MAX_ATTACHMENTS; i++) {
+        shm_attachment_t* attachment = &from->attachments[i];
+        if (!attachment->region) {
+            continue;
+        }
+        int res = shm_map_at(to, attachment->region, attachment->virtual_address);
+        if (res < 0) {
+            return res;
+        }
+    }
+    return ENONE;
+}
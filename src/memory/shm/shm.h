@@ -0,0 +1,43 @@
+#ifndef __SHM_H__
+#define __SHM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+#include "status.h"
+#include "memory/paging/paging.h"
+
+/**
+ * Shared memory regions, for processes to exchange data without copying it through the kernel:
+ * 1. shm_create allocates the zeroed frames of a region and attaches it to the creator.
+ *    Other processes attach it by its id with shm_attach.
+ * 2. Attaching maps the frames of the region into the address space, in the window from
+ *    PROGRAM_VIRTUAL_SHM_START_ADDRESS to PROGRAM_VIRTUAL_SPACE_END_ADDRESS. Each address
+ *    space may attach a region at a different address.
+ * 3. The region counts its attachments and frees its frames when the last one is detached.
+ *    The pages are not marked owned, so the release of a process, zram and copy-on-write
+ *    leave the frames alone.
+ */
+
+typedef struct shm_region shm_region_t;
+
+// A region attached to an address space
+typedef struct shm_attachment {
+    shm_region_t* region; // NULL if the slot is free
+    uint32_t virtual_address; // Page-aligned address the region is mapped at
+} shm_attachment_t;
+
+// The regions attached to an address space, e.g. of a process
+typedef struct shm_space {
+    paging_4gb_chunk_t* chunk; // Address space the regions are mapped into
+    shm_attachment_t attachments[SHM_MAX_ATTACHMENTS];
+} shm_space_t;
+
+void shm_space_init(shm_space_t* space, paging_4gb_chunk_t* chunk);
+int shm_create(shm_space_t* space, size_t size, uint32_t* out_id, uint32_t* out_address);
+int shm_attach(shm_space_t* space, uint32_t id, uint32_t* out_address);
+int shm_detach(shm_space_t* space, uint32_t virtual_address);
+void shm_detach_all(shm_space_t* space);
+int shm_clone_space(shm_space_t* from, shm_space_t* to);
+
+#endif // __SHM_H__
@@ -0,0 +1,115 @@
+#include "uaccess.h"
+
+// Entry of the fixup table, emitted next to the copy routines in uaccess.S
+typedef struct uaccess_fixup {
+    uint32_t instruction; // Address of an instruction which accesses user memory
+    uint32_t fixup;       // Address to continue at if it faults
+} uaccess_fixup_t;
+
+extern uint32_t uaccess_copy_asm(void* dest, const void* src, uint32_t size);
+extern int32_t uaccess_strncpy_asm(char* dest, const char* src, uint32_t max_length);
+extern uaccess_fixup_t uaccess_fixup_table[];
+extern uaccess_fixup_t uaccess_fixup_table_end[];
+
+/**
+ * @brief Check that a user range lies in the program window.
+ * @param address Start of the range.
+ * @param size Size of the range in bytes.
+ * @return true if the range is in the program window, false otherwise.
+ */
+static bool uaccess_range_ok(uintptr_t address, size_t size) {
+    return address >= PROGRAM_VIRTUAL_SPACE_START_ADDRESS &&
+           address <= PROGRAM_VIRTUAL_SPACE_END_ADDRESS &&
+           size <= PROGRAM_VIRTUAL_SPACE_END_ADDRESS - address;
+}
+
+/**
+ * @brief Copy a buffer from the memory of the current task to the kernel.
+ * @param dest Kernel buffer to copy to.
+ * @param user_src Address in the current task to copy from.
+ * @param size Number of bytes to copy.
+ * @return ENONE on success, -EFAULT if the user range is invalid or not mapped.
+ * @note On a fault, dest may have been partially written.
+ */
+int copy_from_user(void* dest, const void* user_src, size_t size) {
+    if (size == 0) {
+        return ENONE;
+    }
+    if (!dest || !uaccess_range_ok((uintptr_t)user_src, size)) {
+        return -EFAULT;
+    }
+
+    return uaccess_copy_asm(dest, user_src, size) == 0 ? ENONE : -EFAULT;
+}
+
+/**
+ * @brief Copy a buffer from the kernel to the memory of the current task.
+ * @param user_dest Address in the current task to copy to.
+ * @param src Kernel buffer to copy from.
+ * @param size Number of bytes to copy.
+ * @return ENONE on success, -EFAULT if the user range is invalid, not mapped or read-only.
+ * @note On a fault, user_dest may have been partially written.
+ */
+int copy_to_user(void* user_dest, const void* src, size_t size) {
+    if (size == 0) {
+        return ENONE;
+    }
+    if (!src || !uaccess_range_ok((uintptr_t)user_dest, size)) {
+        return -EFAULT;
+    }
+
+    return uaccess_copy_asm(user_dest, src, size) == 0 ? ENONE : -EFAULT;
+}
+
+/**
+ * @brief Copy a string from the memory of the current task to the kernel.
+ * @param dest Kernel buffer to copy to, always terminated on success.
+ * @param user_src Address of the string in the current task.
+ * @param max_length Size of dest in bytes. Longer strings are truncated to max_length - 1 characters.
+ * @return The length of the copied string on success, -EINVAL for an empty buffer,
+ *         -EFAULT if the string is not mapped or runs out of the program window.
+ */
+int strncpy_from_user(char* dest, const char* user_src, size_t max_length) {
+    if (!dest || max_length == 0) {
+        return -EINVAL;
+    }
+    uintptr_t address = (uintptr_t)user_src;
+    if (!uaccess_range_ok(address, 1)) {
+        return -EFAULT;
+    }
+
+    // Never read past the program window, the string must end before it
+    size_t length = max_length - 1;
+    bool window_limited = false;
+    if (length > PROGRAM_VIRTUAL_SPACE_END_ADDRESS - address) {
+        length = PROGRAM_VIRTUAL_SPACE_END_ADDRESS - address;
+        window_limited = true;
+    }
+
+    int32_t copied = uaccess_strncpy_asm(dest, user_src, length);
+    if (copied < 0 || (window_limited && (size_t)copied == length)) {
+        return -EFAULT;
+    }
+    dest[copied] = '\0';
+    return copied;
+}
+
+/**
+ * @brief Continue a faulting user memory access at its fixup.
+ *        Called by the page fault handler for kernel faults it could not resolve.
+ * @param frame Pointer to the interrupt stack frame, whose EIP is redirected.
+ * @return true if the faulting instruction has a fixup, false otherwise.
+ */
+bool uaccess_fixup_page_fault(idt_interrupt_stack_frame_t* frame) {
+    if (!frame) {
+        return false;
+    }
+
+    for (uaccess_fixup_t* entry = uaccess_fixup_table; entry < uaccess_fixup_table_end; entry++) {
+        if (entry->instruction == frame->eip) {
+            frame->eip = entry->fixup;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,29 @@
+#ifndef __UACCESS_H__
+#define __UACCESS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "status.h"
+#include "idt/idt.h"
+
+/**
+ * Access to user memory from the kernel, e.g. for system call arguments:
+ * 1. The kernel runs on the page directory of the current task, so user pointers are used
+ *    directly. Nothing is remapped and CR3 is not reloaded.
+ * 2. Pointers must lie in the program window, from PROGRAM_VIRTUAL_SPACE_START_ADDRESS to
+ *    PROGRAM_VIRTUAL_SPACE_END_ADDRESS, so that a task cannot make the kernel read or write
+ *    kernel memory.
+ * 3. Pages which are not yet loaded, compressed or copy-on-write fault, and the page fault
+ *    handler resolves them as for the task itself. If it cannot, it looks up the faulting
+ *    instruction in the fixup table of uaccess.S and continues at its fixup, so that the
+ *    copy returns -EFAULT instead of taking the kernel down.
+ */
+
+int copy_from_user(void* dest, const void* user_src, size_t size);
+int copy_to_user(void* user_dest, const void* src, size_t size);
+int strncpy_from_user(char* dest, const char* user_src, size_t max_length);
+bool uaccess_fixup_page_fault(idt_interrupt_stack_frame_t* frame);
+
+#endif // __UACCESS_H__
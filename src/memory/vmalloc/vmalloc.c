@@ -0,0 +1,192 @@
+#include "vmalloc.h"
+#include "memory/heap/kheap.h"
+#include "memory/memory.h"
+
+/**
+ * @file vmalloc.c
+ * @brief Virtually contiguous kernel allocations backed by scattered heap blocks.
+ */
+
+#define VMALLOC_WINDOW_START ((uint32_t)KERNEL_VMALLOC_ADDRESS)
+#define VMALLOC_WINDOW_END ((uint32_t)KERNEL_VMALLOC_ADDRESS + KERNEL_VMALLOC_SIZE_BYTES)
+
+static paging_4gb_chunk_t* vmalloc_paging_chunk = NULL; // Kernel paging chunk holding the window
+static vmalloc_area_t* vmalloc_area_list = NULL; // Areas sorted by address
+
+/**
+ * @brief Unmap pages of an area and give their frames back to the kernel heap.
+ * @param address Start of the pages in the vmalloc window.
+ * @param num_pages Number of pages to release.
+ */
+static void vmalloc_release_pages(uint32_t address, uint32_t num_pages) {
+    for (uint32_t i = 0; i < num_pages; i++) {
+        uint32_t virtual_address = address + i * PAGE_SIZE;
+        paging_descriptor_entry_t entry = paging_get_page_entry(vmalloc_paging_chunk, virtual_address);
+        if (entry & PAGING_FLAG_PRESENT) {
+            kheap_free((void*)PAGING_ENTRY_GET_ADDRESS(entry));
+        }
+        paging_unmap_virtual_address(vmalloc_paging_chunk, virtual_address);
+    }
+}
+
+/**
+ * @brief Initialize the vmalloc window in the kernel paging chunk.
+ *        The window is unmapped up front so that stray accesses fault
+ *        instead of silently hitting the identity mapping.
+ * @param chunk Pointer to the kernel paging chunk.
+ * @return ENONE on success, negative error code on failure.
+ */
+error_t vmalloc_init(paging_4gb_chunk_t* chunk) {
+    if (!chunk) {
+        return -EINVAL;
+    }
+
+    for (uint32_t address = VMALLOC_WINDOW_START; address < VMALLOC_WINDOW_END; address += PAGE_SIZE) {
+        int res = paging_unmap_virtual_address(chunk, address);
+        if (res != ENONE) {
+            return res;
+        }
+    }
+
+    vmalloc_paging_chunk = chunk;
+    vmalloc_area_list = NULL;
+    return ENONE;
+}
+
+/**
+ * @brief Allocate a virtually contiguous buffer.
+ *        The first gap in the window large enough for the pages plus the guard page is used.
+ * @param size The size of memory to allocate in bytes.
+ * @return Page-aligned pointer into the vmalloc window, or NULL if allocation fails.
+ */
+void* vmalloc(size_t size) {
+    if (!vmalloc_paging_chunk || size == 0 || size > KERNEL_VMALLOC_SIZE_BYTES) {
+        return NULL;
+    }
+
+    uint32_t num_pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    uint32_t area_size = (num_pages + VMALLOC_GUARD_PAGES) * PAGE_SIZE;
+
+    // Find the first gap between areas which can hold the new one
+    uint32_t address = VMALLOC_WINDOW_START;
+    vmalloc_area_t** link = &vmalloc_area_list;
+    while (*link) {
+        if ((*link)->address - address >= area_size) {
+            break;
+        }
+        address = (*link)->address + ((*link)->num_pages + VMALLOC_GUARD_PAGES) * PAGE_SIZE;
+        link = &(*link)->next;
+    }
+    if (VMALLOC_WINDOW_END - address < area_size) {
+        return NULL; // Window exhausted
+    }
+
+    vmalloc_area_t* area = (vmalloc_area_t*)kheap_malloc(sizeof(vmalloc_area_t));
+    if (!area) {
+        return NULL;
+    }
+
+    // Back every page with its own heap block
+    for (uint32_t i = 0; i < num_pages; i++) {
+        void* frame = kheap_malloc_pages(PAGE_SIZE);
+        if (!frame) {
+            vmalloc_release_pages(address, i);
+            kheap_free(area);
+            return NULL;
+        }
+
+        uint32_t virtual_address = address + i * PAGE_SIZE;
+        paging_map_virtual_address(vmalloc_paging_chunk, virtual_address, (uint32_t)frame | PAGING_FLAG_PRESENT | PAGING_FLAG_WRITABLE);
+    }
+
+    area->address = address;
+    area->num_pages = num_pages;
+    area->next = *link;
+    *link = area;
+
+    return (void*)address;
+}
+
+/**
+ * @brief Allocate a zero-initialized virtually contiguous buffer.
+ * @param size The size of memory to allocate in bytes.
+ * @return Page-aligned pointer into the vmalloc window, or NULL if allocation fails.
+ */
+void* vzmalloc(size_t size) {
+    void* ptr = vmalloc(size);
+    if (ptr) {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+/**
+ * @brief Free a buffer returned by vmalloc.
+ * @param ptr Pointer returned by vmalloc.
+ */
+void vfree(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    vmalloc_area_t** link = &vmalloc_area_list;
+    while (*link && (*link)->address != (uint32_t)ptr) {
+        link = &(*link)->next;
+    }
+    if (!*link) {
+        return; // Not the start of a vmalloc area
+    }
+
+    vmalloc_area_t* area = *link;
+    *link = area->next;
+    vmalloc_release_pages(area->address, area->num_pages);
+    kheap_free(area);
+}
+
+/**
+ * @brief Check if a pointer lies in the vmalloc window.
+ * @param ptr The pointer to check.
+ * @return true if the pointer is a vmalloc address, false otherwise.
+ */
+bool vmalloc_is_address(const void* ptr) {
+    return (uint32_t)ptr >= VMALLOC_WINDOW_START && (uint32_t)ptr < VMALLOC_WINDOW_END;
+}
+
+/**
+ * @brief Get the physical address backing a kernel pointer.
+ *        Pointers outside the vmalloc window are identity mapped by the kernel.
+ * @param ptr The kernel pointer.
+ * @return The physical address, or 0 if a vmalloc address is not mapped.
+ */
+uint32_t vmalloc_get_physical_address(const void* ptr) {
+    if (!vmalloc_is_address(ptr)) {
+        return (uint32_t)ptr;
+    }
+    return paging_get_physical_address(vmalloc_paging_chunk, (uint32_t)ptr);
+}
+
+/**
+ * @brief Allocate zero-initialized memory, preferring the physically contiguous kernel heap.
+ *        Large requests fall back to vmalloc when no contiguous run of blocks is left.
+ * @param size The size of memory to allocate in bytes.
+ * @return Pointer to the allocated memory, or NULL if allocation fails. Free it with kvfree.
+ */
+void* kvzmalloc(size_t size) {
+    void* ptr = kheap_zmalloc(size);
+    if (!ptr && size > PAGE_SIZE) {
+        ptr = vzmalloc(size);
+    }
+    return ptr;
+}
+
+/**
+ * @brief Free memory returned by kvzmalloc.
+ * @param ptr Pointer to the memory to free.
+ */
+void kvfree(void* ptr) {
+    if (vmalloc_is_address(ptr)) {
+        vfree(ptr);
+    } else {
+        kheap_free(ptr);
+    }
+}
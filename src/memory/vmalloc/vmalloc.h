@@ -0,0 +1,42 @@
+#ifndef __VMALLOC_H__
+#define __VMALLOC_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "status.h"
+#include "memory/paging/paging.h"
+
+/**
+ * vmalloc builds virtually contiguous buffers out of single heap blocks:
+ * 1. Every page of a buffer is a separate kheap block, so no physically contiguous run is needed.
+ * 2. The pages are mapped back to back into a dedicated window of the kernel address space,
+ *    [KERNEL_VMALLOC_ADDRESS, KERNEL_VMALLOC_ADDRESS + KERNEL_VMALLOC_SIZE_BYTES).
+ * 3. Areas in the window are tracked in a list sorted by address. Each area is followed
+ *    by an unmapped guard page, so overruns fault instead of corrupting the next area.
+ *
+ * vmalloc memory is mapped in the kernel paging chunk and is page-aligned. Task address spaces
+ * share the kernel's page tables of the window, so it is visible from them as well.
+ */
+
+#define VMALLOC_GUARD_PAGES 1
+
+typedef struct vmalloc_area {
+    uint32_t address;          // Start of the area in the vmalloc window
+    uint32_t num_pages;        // Number of mapped pages, excluding the guard page
+    struct vmalloc_area* next; // Next area by address
+} vmalloc_area_t;
+
+error_t vmalloc_init(paging_4gb_chunk_t* chunk);
+void* vmalloc(size_t size);
+void* vzmalloc(size_t size);
+void vfree(void* ptr);
+bool vmalloc_is_address(const void* ptr);
+uint32_t vmalloc_get_physical_address(const void* ptr);
+
+// Allocate from kheap first and fall back to vmalloc when no contiguous run is left
+void* kvzmalloc(size_t size);
+void kvfree(void* ptr);
+
+#endif // __VMALLOC_H__
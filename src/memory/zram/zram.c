@@ -0,0 +1,213 @@
+#include "zram.h"
+#include "memory/heap/kheap.h"
+#include "memory/frame/frame.h"
+#include "memory/memory.h"
+#include "utils/lz.h"
+
+/**
+ * @file zram.c
+ * @brief Compressed in-RAM store for cold user pages.
+ */
+
+#define ZRAM_ENTRY_FLAGS_MASK (PAGING_FLAG_USER | PAGING_FLAG_WRITABLE) // Flags kept while a page is swapped out
+#define ZRAM_ENTRY_GET_SLOT(entry) ((uint32_t)((entry) >> 12))
+
+// Compressed copy of a page
+typedef struct zram_slot {
+    void* data;    // kheap allocation holding the compressed data, NULL for a page of zeros
+    uint32_t size; // Size of the compressed data in bytes
+} zram_slot_t;
+
+static zram_slot_t* zram_slots = NULL;
+static uint32_t* zram_free_slots = NULL; // Stack of free slot indexes
+static uint32_t zram_free_slot_count = 0;
+static uint8_t zram_buffer[ZRAM_MAX_COMPRESSED_SIZE_BYTES]; // Compression output, copied out once the size is known
+static zram_stats_t zram_stats;
+
+/**
+ * @brief Check if a page holds only zeros.
+ * @param page Pointer to the page.
+ * @return true if every byte is zero, false otherwise.
+ */
+static bool zram_is_zero_page(const uint32_t* page) {
+    for (uint32_t i = 0; i < PAGE_SIZE / sizeof(uint32_t); i++) {
+        if (page[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Release the compressed data of a slot and put the slot back on the free stack.
+ * @param slot The slot index.
+ */
+static void zram_release_slot(uint32_t slot) {
+    zram_stats.stored_pages--;
+    zram_stats.compressed_bytes -= zram_slots[slot].size;
+    if (zram_slots[slot].data) {
+        kheap_free(zram_slots[slot].data);
+    }
+    zram_slots[slot].data = NULL;
+    zram_slots[slot].size = 0;
+    zram_free_slots[zram_free_slot_count++] = slot;
+}
+
+/**
+ * @brief Initialize the compressed store.
+ * @return ENONE on success, negative error code on failure.
+ */
+error_t zram_init() {
+    zram_slots = (zram_slot_t*)kheap_zmalloc(ZRAM_MAX_PAGES * sizeof(zram_slot_t));
+    zram_free_slots = (uint32_t*)kheap_malloc(ZRAM_MAX_PAGES * sizeof(uint32_t));
+    if (!zram_slots || !zram_free_slots) {
+        kheap_free(zram_slots);
+        kheap_free(zram_free_slots);
+        zram_slots = NULL;
+        zram_free_slots = NULL;
+        return -ENOMEM;
+    }
+
+    // Hand out the low slots first
+    for (uint32_t i = 0; i < ZRAM_MAX_PAGES; i++) {
+        zram_free_slots[i] = ZRAM_MAX_PAGES - 1 - i;
+    }
+    zram_free_slot_count = ZRAM_MAX_PAGES;
+    memset(&zram_stats, 0, sizeof(zram_stats_t));
+    return ENONE;
+}
+
+/**
+ * @brief Compress a page out of an address space and free its frame.
+ * @param chunk Pointer to the paging chunk of the address space.
+ * @param virtual_address Page-aligned address of the page.
+ * @return ENONE on success, -EINVAL if the page is not an owned present page or is
+ *         copy-on-write, -ENOMEM if it does not compress well enough or the store is full.
+ */
+int zram_swap_out(paging_4gb_chunk_t* chunk, uint32_t virtual_address) {
+    if (!zram_slots || !chunk) {
+        return -EINVAL;
+    }
+
+    paging_descriptor_entry_t entry = paging_get_page_entry(chunk, virtual_address);
+    if (!(entry & PAGING_FLAG_PRESENT) || !(entry & PAGING_FLAG_OWNED) || (entry & PAGING_FLAG_COW)) {
+        return -EINVAL; // The frame of a COW page may still be mapped elsewhere
+    }
+    if (zram_free_slot_count == 0) {
+        return -ENOMEM;
+    }
+
+    void* frame = (void*)PAGING_ENTRY_GET_ADDRESS(entry);
+    void* data = NULL;
+    size_t size = 0;
+    if (!zram_is_zero_page((const uint32_t*)frame)) {
+        size = lz_compress(frame, PAGE_SIZE, zram_buffer, sizeof(zram_buffer));
+        if (size == 0) {
+            zram_stats.incompressible++;
+            return -ENOMEM;
+        }
+        data = kheap_malloc(size);
+        if (!data) {
+            return -ENOMEM;
+        }
+        memcpy(data, zram_buffer, size);
+    }
+
+    uint32_t slot = zram_free_slots[--zram_free_slot_count];
+    zram_slots[slot].data = data;
+    zram_slots[slot].size = size;
+
+    paging_map_virtual_address(chunk, virtual_address, (slot << 12) | PAGING_FLAG_SWAPPED | (entry & ZRAM_ENTRY_FLAGS_MASK));
+    frame_free(frame);
+
+    zram_stats.stored_pages++;
+    zram_stats.compressed_bytes += size;
+    zram_stats.swap_outs++;
+    return ENONE;
+}
+
+/**
+ * @brief Decompress a swapped out page into a new frame and map it back.
+ * @param chunk Pointer to the paging chunk of the address space.
+ * @param virtual_address Page-aligned address of the page.
+ * @return ENONE on success, -EINVAL if the page is not swapped out, -ENOMEM if no frame is left.
+ */
+int zram_swap_in(paging_4gb_chunk_t* chunk, uint32_t virtual_address) {
+    if (!zram_slots || !chunk) {
+        return -EINVAL;
+    }
+
+    paging_descriptor_entry_t entry = paging_get_page_entry(chunk, virtual_address);
+    uint32_t slot = ZRAM_ENTRY_GET_SLOT(entry);
+    if ((entry & PAGING_FLAG_PRESENT) || !(entry & PAGING_FLAG_SWAPPED) || slot >= ZRAM_MAX_PAGES) {
+        return -EINVAL;
+    }
+
+    void* frame = frame_alloc_colored(FRAME_GET_COLOR(virtual_address));
+    if (!frame) {
+        return -ENOMEM;
+    }
+
+    if (!zram_slots[slot].data) {
+        memset(frame, 0, PAGE_SIZE);
+    } else if (lz_decompress(zram_slots[slot].data, zram_slots[slot].size, frame, PAGE_SIZE) != PAGE_SIZE) {
+        frame_free(frame);
+        return -EFAULT; // Corrupted store
+    }
+
+    paging_map_virtual_address(chunk, virtual_address,
+        (uint32_t)frame | PAGING_FLAG_PRESENT | PAGING_FLAG_OWNED | (entry & ZRAM_ENTRY_FLAGS_MASK));
+
+    zram_release_slot(slot);
+    zram_stats.swap_ins++;
+    return ENONE;
+}
+
+/**
+ * @brief Swap out the pages of a range which were not accessed since the previous scan.
+ *        Accessed pages get a second chance: their accessed bit is cleared instead.
+ * @param chunk Pointer to the paging chunk of the address space.
+ * @param start_address Page-aligned start of the range.
+ * @param end_address Page-aligned end of the range (exclusive).
+ * @param max_pages Maximum number of pages to swap out.
+ * @return The number of pages swapped out, i.e. the number of frames freed.
+ */
+uint32_t zram_swap_out_cold_pages(paging_4gb_chunk_t* chunk, uint32_t start_address, uint32_t end_address, uint32_t max_pages) {
+    uint32_t swapped_pages = 0;
+    for (uint32_t address = start_address; address < end_address && swapped_pages < max_pages; address += PAGE_SIZE) {
+        paging_descriptor_entry_t entry = paging_get_page_entry(chunk, address);
+        if (!(entry & PAGING_FLAG_PRESENT) || !(entry & PAGING_FLAG_OWNED) || (entry & PAGING_FLAG_COW)) {
+            continue;
+        }
+
+        if (entry & PAGING_FLAG_ACCESSED) {
+            paging_map_virtual_address(chunk, address, entry & ~(paging_descriptor_entry_t)PAGING_FLAG_ACCESSED);
+            continue;
+        }
+
+        if (zram_swap_out(chunk, address) == ENONE) {
+            swapped_pages++;
+        }
+    }
+    return swapped_pages;
+}
+
+/**
+ * @brief Drop the compressed copy referenced by a page table entry, when an address space goes away.
+ * @param entry The page table entry of a swapped out page.
+ */
+void zram_free_page(paging_descriptor_entry_t entry) {
+    uint32_t slot = ZRAM_ENTRY_GET_SLOT(entry);
+    if (!zram_slots || (entry & PAGING_FLAG_PRESENT) || !(entry & PAGING_FLAG_SWAPPED) || slot >= ZRAM_MAX_PAGES) {
+        return;
+    }
+    zram_release_slot(slot);
+}
+
+/**
+ * @brief Get the counters of the compressed store.
+ * @param stats Pointer to store the counters.
+ */
+void zram_get_stats(zram_stats_t* stats) {
+    *stats = zram_stats;
+}
@@ -0,0 +1,42 @@
+#ifndef __ZRAM_H__
+#define __ZRAM_H__
+
+#include <stdint.h>
+#include "config.h"
+#include "status.h"
+#include "memory/paging/paging.h"
+
+/**
+ * zram keeps cold user pages compressed in kernel heap memory instead of in their own frames:
+ * 1. Only pages marked PAGING_FLAG_OWNED can be swapped out, since their frame is freed.
+ *    Copy-on-write pages are skipped, their frame may be mapped by other address spaces.
+ * 2. A page is compressed with lz_compress into a buffer of ZRAM_MAX_COMPRESSED_SIZE_BYTES.
+ *    The result is copied into a kheap allocation, i.e. an object of a kmalloc size class,
+ *    so compressed pages are packed into slabs. Pages which do not compress that well stay
+ *    resident, and pages full of zeros need no storage at all.
+ * 3. The page table entry becomes not present, with PAGING_FLAG_SWAPPED set and the index of
+ *    the zram slot describing the compressed data in the frame number bits. The user and
+ *    writable flags are kept, so that the page comes back with the same protection.
+ * 4. The page fault handler calls zram_swap_in, which decompresses into a new frame.
+ *
+ * Cold pages are found with the accessed bit (second chance): a page accessed since the
+ * last scan only gets its accessed bit cleared, the others are swapped out.
+ */
+
+// Counters of the compressed store
+typedef struct zram_stats {
+    uint32_t stored_pages;        // Pages currently held compressed
+    uint32_t compressed_bytes;    // Bytes of compressed data currently held
+    uint32_t swap_outs;           // Pages swapped out so far
+    uint32_t swap_ins;            // Pages swapped in so far
+    uint32_t incompressible;      // Swap outs refused because the page did not compress enough
+} zram_stats_t;
+
+error_t zram_init();
+int zram_swap_out(paging_4gb_chunk_t* chunk, uint32_t virtual_address);
+int zram_swap_in(paging_4gb_chunk_t* chunk, uint32_t virtual_address);
+uint32_t zram_swap_out_cold_pages(paging_4gb_chunk_t* chunk, uint32_t start_address, uint32_t end_address, uint32_t max_pages);
+void zram_free_page(paging_descriptor_entry_t entry);
+void zram_get_stats(zram_stats_t* stats);
+
+#endif // __ZRAM_H__
@@ -1,6 +1,11 @@
 #include "process.h"
 #include "memory/heap/kheap.h"
+#include "memory/frame/frame.h"
+#include "memory/memory.h"
 #include "memory/paging/paging.h"
+#include "memory/zram/zram.h"
+#include "memory/cow/cow.h"
+#include "memory/shm/shm.h"
 #include "status.h"
 #include "task/task.h"
 #include "utils/string.h"
@@ -8,6 +13,7 @@
 
 process_t* current_process = NULL; // Pointer to the currently running process
 static process_t* process_table[PROGRAM_MAX_PROCESSES]; // Fixed-size process table
+static frame_shrinker_t process_shrinker; // Swaps cold user pages out to zram when no frame is left
 
 /**
  * @brief Retrieve a process by its slot index.
@@ -22,9 +28,92 @@ process_t* process_get_process_by_slot(uint16_t slot) {
 }
 
 /**
- * @brief Load a binary executable file into memory.
- * @param filename The path to the executable file.
+ * @brief Map a new page into the process, backed by a frame of its own.
+ *        The page is marked as owned, so that its frame is freed with the process
+ *        and zram may compress it out when it gets cold.
+ * @param process Pointer to the process structure.
+ * @param virtual_address Page-aligned user address of the page.
+ * @param data Initial content, or NULL for a page of zeros.
+ * @param size Size of the initial content in bytes, the rest of the page is zeroed.
+ * @return ENONE on success, negative error code on failure.
+ */
+static int process_map_new_page(process_t* process, uint32_t virtual_address, const void* data, size_t size) {
+    // The color of the virtual page keeps neighbouring pages apart in the cache,
+    // pages without data come pre-zeroed when the pool has a frame of the color
+    uint32_t color = FRAME_GET_COLOR(virtual_address);
+    void* frame = data ? frame_alloc_colored(color) : frame_zalloc_colored(color);
+    if (!frame) {
+        return -ENOMEM;
+    }
+    if (data) {
+        memcpy(frame, data, size);
+        memset((uint8_t*)frame + size, 0, PAGE_SIZE - size);
+    }
+
+    int res = paging_map_virtual_address(
+        process->main_task->paging_chunk,
+        virtual_address,
+        (uint32_t)frame | PAGING_FLAG_PRESENT | PAGING_FLAG_USER | PAGING_FLAG_WRITABLE | PAGING_FLAG_OWNED
+    );
+    if (res < 0) {
+        frame_free(frame);
+    }
+    return res;
+}
+
+/**
+ * @brief Get the end of the user pages of a process (stack, then image).
+ * @param process Pointer to the process structure.
+ * @return The page-aligned end address (exclusive).
+ */
+static uint32_t process_get_user_end_address(process_t* process) {
+    return PROGRAM_VIRTUAL_ADDRESS + ((process->file_size + PAGE_SIZE - 1) & ~(uint32_t)(PAGE_SIZE - 1));
+}
+
+/**
+ * @brief Free the frames and compressed copies of the user pages of a process.
+ *        Must run while the page tables still exist.
+ * @param process Pointer to the process structure.
+ */
+static void process_release_pages(process_t* process) {
+    paging_4gb_chunk_t* chunk = process->main_task->paging_chunk;
+    uint32_t end_address = process_get_user_end_address(process);
+    for (uint32_t address = PROGRAM_VIRTUAL_STACK_BOTTOM_ADDRESS; address < end_address; address += PAGE_SIZE) {
+        paging_descriptor_entry_t entry = paging_get_page_entry(chunk, address);
+        if ((entry & PAGING_FLAG_PRESENT) && (entry & PAGING_FLAG_OWNED)) {
+            if (!(entry & PAGING_FLAG_COW) || cow_release_frame((void*)PAGING_ENTRY_GET_ADDRESS(entry))) {
+                frame_free((void*)PAGING_ENTRY_GET_ADDRESS(entry));
+            }
+        } else if (entry & PAGING_FLAG_SWAPPED) {
+            zram_free_page(entry);
+        }
+    }
+}
+
+/**
+ * @brief Leave a range of the process's address space unmapped, so that touching it faults.
+ *        The kernel's identity mapping of the range is replaced by empty private entries.
  * @param process Pointer to the process structure.
+ * @param start_address Page-aligned start of the range.
+ * @param end_address Page-aligned end of the range (exclusive).
+ * @return ENONE on success, negative error code on failure.
+ */
+static int process_reserve_range(process_t* process, uint32_t start_address, uint32_t end_address) {
+    for (uint32_t address = start_address; address < end_address; address += PAGE_SIZE) {
+        int res = paging_unmap_virtual_address(process->main_task->paging_chunk, address);
+        if (res < 0) {
+            return res;
+        }
+    }
+    return ENONE;
+}
+
+/**
+ * @brief Open a binary executable file and reserve its pages in the process.
+ *        Nothing is read yet: the pages are loaded by process_handle_page_fault on first touch,
+ *        so the file stays open as process->fd.
+ * @param filename The path to the executable file.
+ * @param process Pointer to the process structure, with its main task created.
  * @return ENONE on success, negative error code on failure.
  */
 int process_load_binary(const char* filename, process_t* process) {
@@ -41,65 +130,128 @@ int process_load_binary(const char* filename, process_t* process) {
         goto exit;
     }
 
-    // Allocate memory for the executable
     process->file_size = file_state.file_size;
-    process->file_ptr = kheap_zmalloc(process->file_size);
-    if (!process->file_ptr) {
-        res = -ENOMEM;
+    if (process->file_size > PROGRAM_VIRTUAL_SHM_START_ADDRESS - PROGRAM_VIRTUAL_ADDRESS) {
+        res = -EINVAL; // Does not fit below the shared memory window
         goto exit;
     }
 
-    // Read the executable into memory
-    size_t total_read = file_read(process->file_ptr, process->file_size, 1, fd);
-    if (total_read != process->file_size) {
-        res = -EIO;
+    res = process_reserve_range(process, PROGRAM_VIRTUAL_ADDRESS, process_get_user_end_address(process));
+    if (res < 0) {
         goto exit;
     }
+    process->fd = fd;
 
 exit:
-    file_close(fd);
+    if (res < 0) {
+        file_close(fd);
+    }
     return res;
 }
 
 /**
- * @brief Map the process's physical memory into its virtual memory space.
+ * @brief Reserve the process's stack in its virtual memory space.
+ *        The stack grows downwards from PROGRAM_VIRTUAL_STACK_TOP_ADDRESS. Its pages are
+ *        allocated by process_handle_page_fault when touched, down to
+ *        PROGRAM_VIRTUAL_STACK_BOTTOM_ADDRESS. The processor will set the stack pointer (ESP)
+ *        to the top of the stack when switching to user mode.
  * @param process Pointer to the process structure.
  * @return ENONE on success, negative error code on failure.
  */
 int process_map_memory(process_t* process) {
-    int res = 0;
-    // Map the binary to the predefined virtual address
-    res = paging_map_virtual_addresses(
-        process->main_task->paging_chunk,
-        PROGRAM_VIRTUAL_ADDRESS,
-        (uint32_t)process->file_ptr,
-        process->file_size,
-        PAGING_FLAG_PRESENT | PAGING_FLAG_USER | PAGING_FLAG_WRITABLE
-    );
+    return process_reserve_range(process, PROGRAM_VIRTUAL_STACK_BOTTOM_ADDRESS, PROGRAM_VIRTUAL_STACK_TOP_ADDRESS);
+}
+
+/**
+ * @brief Map the page of the process which a not present page fault was raised for.
+ *        Program pages are read from the executable, stack pages start out zeroed.
+ *        The caller retries the faulting instruction on success.
+ * @param process Pointer to the process structure.
+ * @param virtual_address The faulting address (any alignment).
+ * @return ENONE if the page got mapped, -EFAULT if the address is not part of the process,
+ *         or another negative error code on failure.
+ */
+int process_handle_page_fault(process_t* process, uint32_t virtual_address) {
+    if (!process || !process->main_task) {
+        return -EINVAL;
+    }
+
+    uint32_t page_address = virtual_address & ~(uint32_t)(PAGE_SIZE - 1);
+    if (paging_get_page_entry(process->main_task->paging_chunk, page_address) != 0) {
+        return -EFAULT; // Mapped or swapped out, not for us
+    }
+
+    if (page_address >= PROGRAM_VIRTUAL_STACK_BOTTOM_ADDRESS && page_address < PROGRAM_VIRTUAL_STACK_TOP_ADDRESS) {
+        return process_map_new_page(process, page_address, NULL, 0);
+    }
+
+    if (page_address < PROGRAM_VIRTUAL_ADDRESS || page_address >= process_get_user_end_address(process) || !process->fd) {
+        return -EFAULT;
+    }
+
+    uint32_t offset = page_address - PROGRAM_VIRTUAL_ADDRESS;
+    size_t size = process->file_size - offset < PAGE_SIZE ? process->file_size - offset : PAGE_SIZE;
+    void* frame = frame_alloc_colored(FRAME_GET_COLOR(page_address));
+    if (!frame) {
+        return -ENOMEM;
+    }
+    memset((uint8_t*)frame + size, 0, PAGE_SIZE - size);
+
+    int res = file_seek(process->fd, (int32_t)offset, FILE_SEEK_SET);
     if (res < 0) {
         goto exit;
     }
+    if (file_read(frame, size, 1, process->fd) != size) {
+        res = -EIO;
+        goto exit;
+    }
 
-    // Map the stack to the predefined virtual stack address.
-    // Stack grows downwards, so we map from bottom to top.
-    // After mapping, the C program can retrieve the arguments from the stack.
-    // The processor will set the stack pointer (ESP) to the top of the stack
-    // when switching to user mode.
-    res = paging_map_virtual_addresses(
+    res = paging_map_virtual_address(
         process->main_task->paging_chunk,
-        PROGRAM_VIRTUAL_STACK_BOTTOM_ADDRESS,
-        (uint32_t)process->stack,
-        PROGRAM_VIRTUAL_STACK_SIZE_BYTES,
-        PAGING_FLAG_PRESENT | PAGING_FLAG_USER | PAGING_FLAG_WRITABLE
+        page_address,
+        (uint32_t)frame | PAGING_FLAG_PRESENT | PAGING_FLAG_USER | PAGING_FLAG_WRITABLE | PAGING_FLAG_OWNED
     );
-    if (res < 0) {
-        goto exit;
-    }
 
 exit:
+    if (res < 0) {
+        frame_free(frame);
+    }
     return res;
 }
 
+/**
+ * @brief Shrinker of the frame allocator: compress cold user pages of all processes into zram.
+ * @param num_frames Number of frames the allocator would like to get back.
+ * @param data Unused.
+ * @return The number of frames freed, one per page swapped out.
+ */
+static uint32_t process_reclaim(uint32_t num_frames, void* data) {
+    uint32_t freed_frames = 0;
+    for (uint16_t i = 0; i < PROGRAM_MAX_PROCESSES && freed_frames < num_frames; i++) {
+        process_t* process = process_table[i];
+        if (!process || !process->main_task) {
+            continue;
+        }
+        freed_frames += zram_swap_out_cold_pages(
+            process->main_task->paging_chunk,
+            PROGRAM_VIRTUAL_STACK_BOTTOM_ADDRESS,
+            process_get_user_end_address(process),
+            num_frames - freed_frames
+        );
+    }
+    return freed_frames;
+}
+
+/**
+ * @brief Initialize the process module.
+ *        Cold user pages are compressed into zram when the frame allocator runs short.
+ */
+void process_init() {
+    process_shrinker.reclaim = process_reclaim;
+    process_shrinker.data = NULL;
+    frame_register_shrinker(&process_shrinker);
+}
+
 /**
  * @brief Find a free slot in the process table.
  * @return The index of a free slot, or -EBUSY if no slots are available.
@@ -159,13 +311,11 @@ int process_load_into_slot(const char* filename, process_t** out_process, uint16
 
     // Initialize process fields
     process->pid = process_slot; // Assign PID based on slot
-    strncpy(process->filename, filename, sizeof(process->filename) - 1);
-
-    // Load the executable file into memory and populate the process structure, i.e. file_ptr and file_size
-    res = process_load_binary(filename, process);
+    res = arena_init(&process->arena, PROGRAM_ARENA_CHUNK_SIZE_BYTES);
     if (res < 0) {
         goto exit;
     }
+    strncpy(process->filename, filename, sizeof(process->filename) - 1);
 
     // Create the main task for the process
     process->main_task = task_new(process);
@@ -173,15 +323,15 @@ int process_load_into_slot(const char* filename, process_t** out_process, uint16
         res = -ENOMEM;
         goto exit;
     }
+    shm_space_init(&process->shm, process->main_task->paging_chunk);
 
-    // Allocate stack for the process
-    process->stack = kheap_zmalloc(PROGRAM_VIRTUAL_STACK_SIZE_BYTES);
-    if (!process->stack) {
-        res = -ENOMEM;
+    // Open the executable file for the process and populate file_size
+    res = process_load_binary(filename, process);
+    if (res < 0) {
         goto exit;
     }
 
-    // Map main task's physical memory to virtual address space including binary and stack
+    // Reserve the stack of the main task
     res = process_map_memory(process);
     if (res < 0) {
         goto exit;
@@ -194,16 +344,135 @@ int process_load_into_slot(const char* filename, process_t** out_process, uint16
 exit:
     if (res < 0) {
         // Cleanup on error
-        if (process) {
-            // Free associated resources
-            if (process->main_task) {
-                task_free(process->main_task);
+        process_free(process);
+    }
+    return res;    
+}
+
+/**
+ * @brief Clone a process into a free slot, sharing its user frames copy-on-write.
+ *        The child resumes where the parent's main task entered the kernel, with EAX = 0.
+ *        Only the page tables of the user range are built, no page is copied until written.
+ *        Attached shared memory regions are attached to the child at the same addresses.
+ * @param parent Pointer to the process to clone.
+ * @param out_process Pointer to store the created process.
+ * @return ENONE on success, negative error code on failure.
+ */
+int process_fork(process_t* parent, process_t** out_process) {
+    int res = 0;
+    process_t* process = NULL;
+
+    if (!parent || !parent->main_task || !out_process) {
+        return -EINVAL;
+    }
+
+    int slot = process_get_free_slot();
+    if (slot < 0) {
+        return slot; // Propagate error code
+    }
+
+    process = (process_t*)kheap_zmalloc(sizeof(process_t));
+    if (!process) {
+        res = -ENOMEM;
+        goto exit;
+    }
+
+    process->pid = (uint16_t)slot;
+    res = arena_init(&process->arena, PROGRAM_ARENA_CHUNK_SIZE_BYTES);
+    if (res < 0) {
+        goto exit;
+    }
+    strncpy(process->filename, parent->filename, sizeof(process->filename) - 1);
+    process->file_size = parent->file_size;
+
+    process->main_task = task_new(process);
+    if (!process->main_task) {
+        res = -ENOMEM;
+        goto exit;
+    }
+    shm_space_init(&process->shm, process->main_task->paging_chunk);
+    process->main_task->registers = parent->main_task->registers;
+    process->main_task->registers.eax = 0; // Return value of the fork in the child
+
+    // The child loads the pages the parent did not touch yet from its own descriptor
+    if (parent->fd) {
+        int fd = file_open(process->filename, "r");
+        if (fd < 0) {
+            res = fd;
+            goto exit;
+        }
+        process->fd = fd;
+    }
+
+    paging_4gb_chunk_t* parent_chunk = parent->main_task->paging_chunk;
+    paging_4gb_chunk_t* chunk = process->main_task->paging_chunk;
+    uint32_t end_address = process_get_user_end_address(process);
+    for (uint32_t address = PROGRAM_VIRTUAL_STACK_BOTTOM_ADDRESS; address < end_address; address += PAGE_SIZE) {
+        paging_descriptor_entry_t entry = paging_get_page_entry(parent_chunk, address);
+        if (entry & PAGING_FLAG_SWAPPED) {
+            // Bring it back rather than sharing the compressed copy
+            res = zram_swap_in(parent_chunk, address);
+            if (res < 0) {
+                goto exit;
             }
-            // TODO: Free all the process data
-            // kheap_free(process);
+            entry = paging_get_page_entry(parent_chunk, address);
+        }
+
+        if (entry == 0) {
+            res = paging_unmap_virtual_address(chunk, address); // Not touched yet, keep it reserved
+        } else if ((entry & PAGING_FLAG_PRESENT) && (entry & PAGING_FLAG_OWNED)) {
+            res = cow_share_page(parent_chunk, chunk, address);
+        }
+        if (res < 0) {
+            goto exit;
         }
     }
-    return res;    
+
+    // Shared memory stays shared with the child, at the same addresses
+    res = shm_clone_space(&parent->shm, &process->shm);
+    if (res < 0) {
+        goto exit;
+    }
+
+    process_table[slot] = process;
+    *out_process = process;
+
+exit:
+    if (res < 0) {
+        process_free(process);
+    }
+    return res;
+}
+
+/**
+ * @brief Free a process and everything it owns.
+ *        The user pages are found through the page tables, which live in the process
+ *        arena together with the rest of the kernel side memory and go away in one go.
+ *        The process must not be running on its own page tables.
+ * @param process Pointer to the process to free, may be NULL.
+ */
+void process_free(process_t* process) {
+    if (!process) {
+        return;
+    }
+
+    if (process_table[process->pid] == process) {
+        process_table[process->pid] = NULL;
+    }
+    if (current_process == process) {
+        current_process = NULL;
+    }
+
+    if (process->main_task) {
+        shm_detach_all(&process->shm);
+        process_release_pages(process);
+        task_free(process->main_task);
+    }
+    if (process->fd) {
+        file_close(process->fd);
+    }
+    arena_destroy(&process->arena);
+    kheap_free(process);
 }
 
 /**
@@ -3,6 +3,8 @@
 
 #include "task.h"
 #include "config.h"
+#include "memory/arena/arena.h"
+#include "memory/shm/shm.h"
 #include <stdint.h>
 
 typedef struct task task_t; // Forward declaration
@@ -12,10 +14,10 @@ typedef struct process {
     uint16_t pid; // Process ID
     char filename[256]; // Executable filename
     task_t* main_task; // Pointer to the main task of the process
-    void* mem_alloc[PROGRAM_MAX_ALLOCATIONS]; // Track memory allocations (malloc) which need to be freed on process termination
-    void* file_ptr; // File pointer to the executable file
-    uint32_t file_size; // Size of the executable file
-    void* stack; // Pointer to the process's stack
+    arena_t arena; // Owns the kernel side memory of the process (page tables), released at once on termination
+    uint32_t file_size; // Size of the executable file, mapped at PROGRAM_VIRTUAL_ADDRESS
+    int fd; // The executable, kept open to load its pages on first touch. 0 if not open
+    shm_space_t shm; // Shared memory regions attached to the process, detached on termination
 
     // Keyboard ring buffer to store keyboard input for this process
     struct keyboard_buffer {
@@ -25,11 +27,15 @@ typedef struct process {
     } keyboard;
 } process_t;
 
+void process_init();
 int process_load(const char* filename, process_t** out_process);
 int process_load_into_slot(const char* filename, process_t** out_process, uint16_t process_slot);
 process_t* process_get_current();
 process_t* process_get_by_pid(uint16_t pid);
 int process_switch(process_t* process);
 int process_load_switch(const char* filename, process_t** out_process);
+void process_free(process_t* process);
+int process_handle_page_fault(process_t* process, uint32_t virtual_address);
+int process_fork(process_t* parent, process_t** out_process);
 
 #endif // __PROCESS_H__
\ No newline at end of file
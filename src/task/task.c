@@ -2,6 +2,8 @@
 #include "memory/memory.h"
 #include "memory/paging/paging.h"
 #include "memory/heap/kheap.h"
+#include "memory/arena/arena.h"
+#include "memory/uaccess/uaccess.h"
 #include "status.h"
 #include "config.h"
 #include "kernel.h"
@@ -81,7 +83,12 @@ int task_init(task_t* task, process_t* process) {
     // Reset task fields
     memset(task, 0, sizeof(task_t));
     task->pid = 0; // Assign a PID as necessary
-    task->paging_chunk = paging_4gb_chunk_init(PAGING_FLAG_PRESENT | PAGING_FLAG_USER | PAGING_FLAG_WRITABLE); // Maping chunk for the task
+    // Maping chunk for the task, owned by the process arena. It shares the kernel's page tables
+    // until the process maps its own pages into a region.
+    task->paging_chunk = paging_4gb_chunk_init_shared(
+        process ? &process->arena : NULL,
+        kernel_get_paging_chunk()
+    );
     if (!task->paging_chunk) {
         return -ENOMEM;
     }
@@ -132,9 +139,15 @@ int task_free(task_t* task) {
 
     // Unlink from the task list
     task_list_remove(task);
+    if (current_task == task) {
+        current_task = task_list_head;
+    }
 
-    // Free paging chunk
+    // Free paging chunk, after leaving it if the kernel still runs on it
     if (task->paging_chunk) {
+        if (paging_get_current_4gb_chunk() == task->paging_chunk) {
+            paging_switch_4gb_chunk(kernel_get_paging_chunk());
+        }
         paging_4gb_chunk_free(task->paging_chunk);
     }
 
@@ -193,7 +206,8 @@ int task_page_current() {
         return EINVAL;
     }
 
-    // Retrieve user's data segment selector and switch to current task's paging chunk
+    // Retrieve user's data segment selector and switch to current task's paging chunk,
+    // which only reloads CR3 if another task became current in the meantime
     task_restore_user_data_segment();
     task_switch(current_task);
     return ENONE;
@@ -243,94 +257,19 @@ void task_save_current_state(idt_interrupt_stack_frame_t* frame) {
 }
 
 /**
- * @brief Copy a string from the virtual address space of a task to a physical address in the kernel.
- * @param task Pointer to the task from which to copy the string.
- * @param src_virt_addr Source virtual address in the task's address space.
- * @param dest_phys_addr Destination physical address in the kernel space.
- * @param max_length Maximum length of the string to copy. (range: 1 to PAGE_SIZE)
- * @return ENONE on success, negative error code on failure.
- * @note This function should be called in kernel mode. In order to copy data from user mode tasks,
- *       the paging must be temporarily switched to the task's paging chunk, and then switched back to kernel paging.
- *       A temporary buffer in kernel space is used as an intermediary to facilitate the copy operation.
- *       After the operation, the original page mapping is restored to maintain memory integrity.
- *       For instance, if the temporary buffer overlaps with the task's memory, the original mapping must be restored.
+ * @brief Read an item from the user stack of a task, e.g. a system call argument.
+ * @param task Pointer to the task, whose page directory must be the loaded one.
+ * @param index Index of the 32-bit item above the saved user stack pointer.
+ * @param out Pointer to store the item.
+ * @return ENONE on success, -EINVAL for a task which is not loaded, -EFAULT for a bad stack.
+ * @note The kernel runs on the page directory of the task during a system call, so the item
+ *       is read in place with copy_from_user.
  */
-int task_copy_string_from_task(task_t* task, const char* src_virt_addr, char* dest_phys_addr, size_t max_length) {
-    if (!task || !src_virt_addr || !dest_phys_addr || max_length == 0) {
-        return -EINVAL;
-    }
-    if (max_length > PAGE_SIZE) {
+int task_get_stack_item(task_t* task, uint32_t index, uint32_t* out) {
+    if (!task || !out || task->paging_chunk != paging_get_current_4gb_chunk()) {
         return -EINVAL;
     }
 
-    int res = 0;
-    // Allocate a temporary buffer in kernel space as a shared area between the task and the kernel
-    char* temp_buffer = (char*)kheap_zmalloc(max_length);
-    if (!temp_buffer) {
-        return -ENOMEM;
-    }
-    // Save the original page table entry to restore later, because the temp buffer (physical address) may overlap with task's memory
-    uint32_t original_page_entry = paging_get_page_entry(task->paging_chunk, (uint32_t)temp_buffer);
-    if (original_page_entry == 0) {
-        res = -ENOTFOUND; // Page not mapped
-        goto exit;
-    }
-    // Map the temporary buffer (physical address) into the task's paging chunk at the same address of temp_buffer (virtual address)
-    res = paging_map_virtual_address(task->paging_chunk, (uint32_t)temp_buffer, (uint32_t)temp_buffer | PAGING_FLAG_PRESENT | PAGING_FLAG_USER | PAGING_FLAG_WRITABLE);
-    if (res != ENONE) {
-        goto exit;
-    }
-    // Kernel landscape above
-    ////////////////////////////////
-    // User landscape below
-    // Switch to the task's paging chunk to copy data from its virtual address space
-    paging_switch_4gb_chunk(task->paging_chunk);
-    // Copy the string from the task's virtual address to the temporary buffer
-    strncpy(temp_buffer, src_virt_addr, max_length);
-    ////////////////////////////////
-    // Kernel landscape below
-    // Restore to kernel paging
-    kernel_page();
-    // Copy the string from the temporary buffer to the destination physical address
-    strncpy(dest_phys_addr, temp_buffer, max_length);
-    // Restore the original page entry
-    res = paging_map_virtual_address(task->paging_chunk, (uint32_t)temp_buffer, original_page_entry);
-    if (res != ENONE) {
-        goto exit;
-    }
-
-exit:
-    kheap_free(temp_buffer);
-    return res;
+    const uint32_t* stack_base = (const uint32_t*)(task->registers.user_esp);
+    return copy_from_user(out, &stack_base[index], sizeof(uint32_t));
 }
-
-void* task_get_stack_item(task_t* task, uint32_t index) {
-    if (!task) {
-        return NULL;
-    }
-
-    //////////////////////
-    // Kernel landscape //
-    //////////////////////
-    // This function is supposed to be called in kernel mode.
-    // Calculate the address of the stack item based on the index
-    // Retrieve the base of the stack from the task's saved user ESP
-    uint32_t* stack_base = (uint32_t*)(task->registers.user_esp);
-    
-    ///////////////////////
-    // User paging below //
-    ///////////////////////
-    // Switch to the task's page to access its stack
-    task_page_task(task);
-
-    // Read the stack item
-    void* result = (void*)(stack_base[index]);
-
-    /////////////////////////
-    // Kernel paging below //
-    /////////////////////////
-    // Restore to kernel paging
-    kernel_page();
-
-    return result;
-}
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "lz.h"
+#include "status.h"
+
+/**
+ * @file lz.c
+ * @brief LZ77 compression of small buffers (see lz.h for the format).
+ */
+
+#define LZ_HASH_BITS 10
+#define LZ_HASH_SIZE (1 << LZ_HASH_BITS)
+#define LZ_NIBBLE_MAX 15
+#define LZ_MAX_OFFSET 0xFFFF
+
+/**
+ * @brief Read 4 bytes as a little-endian word, without alignment requirements.
+ * @param p Pointer to the bytes.
+ * @return The word.
+ */
+static inline uint32_t lz_read32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief Hash a 4-byte prefix into the match table (Fibonacci hashing).
+ * @param value The prefix.
+ * @return The table index.
+ */
+static inline uint32_t lz_hash(uint32_t value) {
+    return (value * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+/**
+ * @brief Write the extension bytes of a length which did not fit in its nibble.
+ * @param dest The output buffer.
+ * @param pos Pointer to the write position, advanced.
+ * @param capacity Size of the output buffer.
+ * @param length The remaining length (the full length minus LZ_NIBBLE_MAX).
+ * @return true if the bytes fit, false otherwise.
+ */
+static bool lz_write_length(uint8_t* dest, size_t* pos, size_t capacity, size_t length) {
+    while (length >= 255) {
+        if (*pos >= capacity) {
+            return false;
+        }
+        dest[(*pos)++] = 255;
+        length -= 255;
+    }
+    if (*pos >= capacity) {
+        return false;
+    }
+    dest[(*pos)++] = (uint8_t)length;
+    return true;
+}
+
+/**
+ * @brief Write a sequence: token, literals and, if match_length is not 0, the match.
+ * @param dest The output buffer.
+ * @param pos Pointer to the write position, advanced.
+ * @param capacity Size of the output buffer.
+ * @param literals Pointer to the literals.
+ * @param literal_length Number of literals.
+ * @param offset Distance of the match backwards from the current position.
+ * @param match_length Length of the match, 0 for the last sequence.
+ * @return true if the sequence fits, false otherwise.
+ */
+static bool lz_write_sequence(uint8_t* dest, size_t* pos, size_t capacity,
+                              const uint8_t* literals, size_t literal_length,
+                              uint32_t offset, size_t match_length) {
+    if (*pos >= capacity) {
+        return false;
+    }
+
+    size_t token_pos = (*pos)++;
+    uint8_t token = 0;
+
+    // Literal length and the literals themselves
+    if (literal_length >= LZ_NIBBLE_MAX) {
+        token = LZ_NIBBLE_MAX << 4;
+        if (!lz_write_length(dest, pos, capacity, literal_length - LZ_NIBBLE_MAX)) {
+            return false;
+        }
+    } else {
+        token = (uint8_t)(literal_length << 4);
+    }
+    if (literal_length > capacity - *pos) {
+        return false;
+    }
+    for (size_t i = 0; i < literal_length; i++) {
+        dest[(*pos)++] = literals[i];
+    }
+
+    // Offset and match length
+    if (match_length > 0) {
+        if (capacity - *pos < 2) {
+            return false;
+        }
+        dest[(*pos)++] = (uint8_t)offset;
+        dest[(*pos)++] = (uint8_t)(offset >> 8);
+
+        size_t length = match_length - LZ_MIN_MATCH;
+        if (length >= LZ_NIBBLE_MAX) {
+            token |= LZ_NIBBLE_MAX;
+            if (!lz_write_length(dest, pos, capacity, length - LZ_NIBBLE_MAX)) {
+                return false;
+            }
+        } else {
+            token |= (uint8_t)length;
+        }
+    }
+
+    dest[token_pos] = token;
+    return true;
+}
+
+size_t lz_compress(const void* src, size_t src_size, void* dest, size_t dest_capacity) {
+    const uint8_t* in = (const uint8_t*)src;
+    uint8_t* out = (uint8_t*)dest;
+    if (!in || !out || src_size > LZ_MAX_INPUT_SIZE) {
+        return 0;
+    }
+
+    uint16_t table[LZ_HASH_SIZE] = {0}; // Last position of each hashed prefix
+    size_t pos = 0;
+    size_t anchor = 0; // Start of the pending literals
+    size_t out_pos = 0;
+
+    while (pos + LZ_MIN_MATCH <= src_size) {
+        uint32_t prefix = lz_read32(in + pos);
+        uint32_t hash = lz_hash(prefix);
+        size_t candidate = table[hash];
+        table[hash] = (uint16_t)pos;
+
+        if (candidate >= pos || pos - candidate > LZ_MAX_OFFSET || lz_read32(in + candidate) != prefix) {
+            pos++;
+            continue;
+        }
+
+        size_t match_length = LZ_MIN_MATCH;
+        while (pos + match_length < src_size && in[candidate + match_length] == in[pos + match_length]) {
+            match_length++;
+        }
+
+        if (!lz_write_sequence(out, &out_pos, dest_capacity, in + anchor, pos - anchor, pos - candidate, match_length)) {
+            return 0;
+        }
+        pos += match_length;
+        anchor = pos;
+    }
+
+    // The rest is emitted as literals
+    if (!lz_write_sequence(out, &out_pos, dest_capacity, in + anchor, src_size - anchor, 0, 0)) {
+        return 0;
+    }
+    return out_pos;
+}
+
+int lz_decompress(const void* src, size_t src_size, void* dest, size_t dest_capacity) {
+    const uint8_t* in = (const uint8_t*)src;
+    uint8_t* out = (uint8_t*)dest;
+    if (!in || !out) {
+        return -EINVAL;
+    }
+
+    size_t in_pos = 0;
+    size_t out_pos = 0;
+    while (in_pos < src_size) {
+        uint8_t token = in[in_pos++];
+
+        // Literals
+        size_t literal_length = token >> 4;
+        if (literal_length == LZ_NIBBLE_MAX) {
+            uint8_t extension;
+            do {
+                if (in_pos >= src_size) {
+                    return -EINVAL;
+                }
+                extension = in[in_pos++];
+                literal_length += extension;
+            } while (extension == 255);
+        }
+        if (literal_length > src_size - in_pos || literal_length > dest_capacity - out_pos) {
+            return -EINVAL;
+        }
+        for (size_t i = 0; i < literal_length; i++) {
+            out[out_pos++] = in[in_pos++];
+        }
+
+        // The last sequence has no match
+        if (in_pos == src_size) {
+            break;
+        }
+
+        // Match
+        if (src_size - in_pos < 2) {
+            return -EINVAL;
+        }
+        size_t offset = (size_t)in[in_pos] | ((size_t)in[in_pos + 1] << 8);
+        in_pos += 2;
+        if (offset == 0 || offset > out_pos) {
+            return -EINVAL;
+        }
+
+        size_t match_length = (token & LZ_NIBBLE_MAX) + LZ_MIN_MATCH;
+        if ((token & LZ_NIBBLE_MAX) == LZ_NIBBLE_MAX) {
+            uint8_t extension;
+            do {
+                if (in_pos >= src_size) {
+                    return -EINVAL;
+                }
+                extension = in[in_pos++];
+                match_length += extension;
+            } while (extension == 255);
+        }
+        if (match_length > dest_capacity - out_pos) {
+            return -EINVAL;
+        }
+
+        // Byte by byte, since the match may overlap the bytes being written
+        for (size_t i = 0; i < match_length; i++) {
+            out[out_pos] = out[out_pos - offset];
+            out_pos++;
+        }
+    }
+
+    return (int)out_pos;
+}
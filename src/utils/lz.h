@@ -0,0 +1,46 @@
+#ifndef __LZ_H__
+#define __LZ_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Small LZ77 compressor in the spirit of LZ4, tuned for single pages:
+ * 1. The output is a series of sequences. A sequence starts with a token byte whose high
+ *    nibble is the number of literals and whose low nibble is the match length minus
+ *    LZ_MIN_MATCH. A nibble of 15 is followed by extension bytes which are added to it,
+ *    as long as the previous one was 255.
+ * 2. The literals follow the token, then the 16-bit little-endian offset of the match
+ *    backwards from the current position, then the match length extension bytes.
+ * 3. The last sequence only holds literals, it ends where the input ends.
+ * 4. Matches are found through a small hash table of the last position of each 4-byte
+ *    prefix, so compression is a single pass with no allocation.
+ */
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_INPUT_SIZE 0xFFFF // Positions are kept in 16 bits
+
+/**
+ * @brief Compress a buffer.
+ * @param src The data to compress, at most LZ_MAX_INPUT_SIZE bytes.
+ * @param src_size Size of the data in bytes.
+ * @param dest The buffer for the compressed data.
+ * @param dest_capacity Size of the destination buffer in bytes.
+ * @return The size of the compressed data, or 0 if it does not fit in the destination buffer.
+ */
+size_t lz_compress(const void* src, size_t src_size, void* dest, size_t dest_capacity);
+
+/**
+ * @brief Decompress a buffer produced by lz_compress.
+ *        Corrupted input never makes it read or write out of bounds.
+ * @param src The compressed data.
+ * @param src_size Size of the compressed data in bytes.
+ * @param dest The buffer for the decompressed data.
+ * @param dest_capacity Size of the destination buffer in bytes.
+ * @return The size of the decompressed data, or a negative error code if the input is corrupted
+ *         or does not fit in the destination buffer.
+ */
+int lz_decompress(const void* src, size_t src_size, void* dest, size_t dest_capacity);
+
+#endif // __LZ_H__